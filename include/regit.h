@@ -1,6 +1,10 @@
 #ifndef REGIT_H_
 #define REGIT_H_
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -16,13 +20,18 @@ enum Status {
   kParserUnsupported,
   kParserUnexpected,
   kParserMissingLeftParenthesis,
-  kParserMissingRightParenthesis
+  kParserMissingRightParenthesis,
+  kIOError,
+  kInvalidFormat
 };
 
 namespace internal {
 // Structure used to track internal compilation information.
 // A forward declaration is required here to reference it from class Regit.
 class RegexpInfo;
+class RegexpSetInfo;
+class Scratch;
+class Stream;
 }
 
 
@@ -32,9 +41,24 @@ class Options {
   //   posix_period:
   //     When unset, period ('.') does not match newline characters. When set,
   //     they match everything except end-of-string delimiter
-  Options(bool posix_period = false) :
-      posix_period_(posix_period) {}
+  //   max_dfa_states:
+  //     When not 0, a complete minimized DFA is built at compilation time, as
+  //     long as it does not require more than this number of states (at most
+  //     2^24 - 1). Matching with it costs a table lookup per byte, and no
+  //     allocation. 0 disables it.
+  //   jit:
+  //     When set, the DFA is compiled to native code, for `MatchFull()` and
+  //     `MatchAnywhere()`. A DFA is then built even if `max_dfa_states` is 0,
+  //     with a budget of 4096 states. Where native code cannot be generated
+  //     (unsupported architecture, or executable memory unavailable), matching
+  //     falls back to the DFA tables.
+  Options(bool posix_period = false, uint32_t max_dfa_states = 0,
+          bool jit = false) :
+      posix_period_(posix_period), max_dfa_states_(max_dfa_states),
+      jit_(jit) {}
   bool posix_period_;
+  uint32_t max_dfa_states_;
+  bool jit_;
 };
 
 
@@ -56,36 +80,223 @@ enum MatchType {
   kAll
 };
 
+// Memory used while matching.
+// By default, each thread uses its own internal context, so that matching does
+// not allocate memory once the context has grown to the size required.
+// A context can also be created explicitly and passed to the match methods,
+// for example to control its lifetime. A context can be used with any regexp,
+// but must not be used by multiple threads at the same time.
+class MatchContext {
+ public:
+  MatchContext();
+  ~MatchContext();
+
+  internal::Scratch* scratch() const { return scratch_; }
+
+ private:
+  internal::Scratch* scratch_;
+
+  MatchContext(const MatchContext&) = delete;
+  void operator=(const MatchContext&) = delete;
+};
+
+
 class Regit {
  public:
-  // The regexp must be '\0'-terminated.
   explicit Regit(const char* regexp);
   explicit Regit(const string& regexp);
   ~Regit();
 
-  void Compile(const Options* options = &regit_default_options);
+  // Compilation happens exactly once. The first call to `Compile()`, explicit
+  // or implicit from one of the match methods, compiles the regexp. Further
+  // calls are no-ops. The compiled regexp is then immutable, so a single
+  // `Regit` can be used concurrently from any number of threads.
+  void Compile(const Options* options = &regit_default_options) const;
+
+  bool MatchFull(const string& text,
+                 MatchContext* context = nullptr) const;
+  bool MatchFull(const char* text, size_t text_size,
+                 MatchContext* context = nullptr) const;
+  bool MatchAnywhere(Match* match, const string& text,
+                     MatchContext* context = nullptr) const;
+  bool MatchAnywhere(Match* match, const char* text, size_t text_size,
+                     MatchContext* context = nullptr) const;
+  bool MatchFirst(Match* match, const string& text,
+                  MatchContext* context = nullptr) const;
+  bool MatchFirst(Match* match, const char* text, size_t text_size,
+                  MatchContext* context = nullptr) const;
+  bool MatchAll(vector<Match>* matches, const string& text,
+                MatchContext* context = nullptr) const;
+  bool MatchAll(vector<Match>* matches, const char* text, size_t text_size,
+                MatchContext* context = nullptr) const;
+
+  // The status of the compilation, `kSuccess` until the regexp has been
+  // compiled. This does not compile the regexp, so that the options are those
+  // of the first call to `Compile()` or to a match method. It can be called
+  // while another thread is compiling.
+  Status status() const { return status_; }
+
+  // Serialization ---------------------------------------------------
+
+  // Write the compiled forms of `regexps` to the file at `path`. The regexps
+  // are compiled if they have not been yet, and must compile successfully.
+  static Status Save(const char* path, const vector<const Regit*>& regexps);
+  // Load the regexps saved in the file at `path`, and append them to
+  // `regexps`, in the order they were saved.
+  // The file is mapped read-only, and the regexps match directly from the
+  // mapped pages, without parsing nor building any automaton. The pages can
+  // be shared by all processes loading the same file.
+  static Status Load(const char* path, vector<unique_ptr<Regit>>* regexps);
+
+ private:
+  void DoCompile(const Options* options) const;
+
+  // A copy of the regexp, so that it can be compiled lazily.
+  const string regexp_;
+
+  // Guards compilation. The members below are only written under it.
+  mutable once_flag compiled_;
+  // If anything went wrong, this should indicate what did. It is atomic so
+  // that `status()` can read it during compilation.
+  mutable atomic<Status> status_;
+
+ public:
+  // The compiled regexp. It may be shared with other `Regit` objects via the
+  // compilation cache.
+  mutable shared_ptr<const internal::RegexpInfo> rinfo_;
+};
+
+
+// A set of regexps matched together, in a single pass over the text.
+//
+//   regit::RegitSet set;
+//   set.Add("error");     // Index 0.
+//   set.Add("time.ut");   // Index 1.
+//   vector<bool> matching;
+//   set.MatchAnywhere(&matching, line);
+//
+// The cost of matching grows with the number of regexps that can start at each
+// position of the text, rather than with the total number of regexps, so this
+// is much faster than matching many `Regit` objects in turn.
+class RegitSet {
+ public:
+  RegitSet();
+  ~RegitSet();
+
+  // Add a regexp to the set, and return its index in the set. Regexps must be
+  // added before the set is compiled.
+  size_t Add(const string& regexp);
+  size_t size() const { return regexps_.size(); }
+
+  // Like `Regit::Compile()`. Compilation fails if any of the regexps fails to
+  // compile. The DFA and JIT options do not apply to sets.
+  void Compile(const Options* options = &regit_default_options) const;
 
-  bool MatchFull(const string& text);
-  bool MatchFull(const char* text, size_t text_size);
-  bool MatchAnywhere(Match* match, const string& text);
-  bool MatchAnywhere(Match* match, const char* text, size_t text_size);
-  bool MatchFirst(Match* match, const string& text);
-  bool MatchFirst(Match* match, const char* text, size_t text_size);
-  bool MatchAll(vector<Match>* matches, const string& text);
-  bool MatchAll(vector<Match>* matches, const char* text, size_t text_size);
+  // Set `(*matching)[i]` to whether the regexp of index `i` matches anywhere
+  // in the text. When `matches` is not nullptr, also set `(*matches)[i]` to
+  // the match `Regit::MatchAnywhere()` would find for this regexp, or to
+  // {kInvalidPos, kInvalidPos} if there is none. Returns true if any regexp
+  // matches.
+  bool MatchAnywhere(vector<bool>* matching, const string& text,
+                     vector<Match>* matches = nullptr,
+                     MatchContext* context = nullptr) const;
+  bool MatchAnywhere(vector<bool>* matching,
+                     const char* text, size_t text_size,
+                     vector<Match>* matches = nullptr,
+                     MatchContext* context = nullptr) const;
 
+  // Like `Regit::status()`, this does not compile the set.
   Status status() const { return status_; }
 
  private:
-  char const * const regexp_;
-  size_t regexp_size_;
+  void DoCompile(const Options* options) const;
+
+  vector<string> regexps_;
+
+  // Guards compilation. The members below are only written under it.
+  mutable once_flag compiled_;
+  mutable atomic<Status> status_;
+  mutable unique_ptr<const internal::RegexpSetInfo> info_;
+
+  RegitSet(const RegitSet&) = delete;
+  void operator=(const RegitSet&) = delete;
+};
+
+
+// A match in a stream, as offsets from the start of the stream.
+class StreamMatch {
+ public:
+  uint64_t start;
+  uint64_t end;
+};
 
-  // If anything went wrong, this should indicate what did.
+// Matches a regexp on a text received in chunks, for example from a socket,
+// without ever holding the whole text. The matches are those
+// `Regit::MatchAll()` would find in the concatenation of the chunks.
+//
+//   regit::RegitStream stream(&re);
+//   vector<regit::StreamMatch> matches;
+//   while (ReadChunk(&chunk)) {
+//     stream.Feed(&matches, chunk);
+//   }
+//   stream.Finish(&matches);
+//
+// A match is reported by the first call that makes it final, which may come
+// after its end. The memory used depends on the regexp, but not on the length
+// of the stream. A stream must not be used by multiple threads at the same
+// time.
+class RegitStream {
+ public:
+  // The regexp is compiled if it has not been yet.
+  explicit RegitStream(const Regit* regit);
+  ~RegitStream();
+
+  // Append to `matches` the matches made final by the chunk. Returns true if
+  // any was.
+  bool Feed(vector<StreamMatch>* matches, const string& chunk);
+  bool Feed(vector<StreamMatch>* matches,
+            const char* chunk, size_t chunk_size);
+  // End the text, and append the remaining matches to `matches`. Returns true
+  // if any was. The stream can then be fed a new text.
+  bool Finish(vector<StreamMatch>* matches);
+  // Drop the text fed so far, to start a new one.
+  void Reset();
+
+  Status status() const { return status_; }
+
+ private:
   Status status_;
+  // Keeps the compiled regexp alive for the stream.
+  shared_ptr<const internal::RegexpInfo> rinfo_;
+  unique_ptr<internal::Stream> stream_;
+
+  RegitStream(const RegitStream&) = delete;
+  void operator=(const RegitStream&) = delete;
+};
+
+
+// Compilation cache -----------------------------------------------------------
+
+// When enabled, compiled regexps are kept in a process-wide cache keyed by the
+// regexp and the options used to compile it. Compiling a regexp found in the
+// cache skips parsing and automaton construction, and shares the compiled
+// regexp with the other `Regit` objects using it.
+// The cache holds at most `byte_budget` bytes of compiled regexps, and evicts
+// the least recently used ones first. It is disabled by default.
+void EnableCompilationCache(size_t byte_budget = 64 * 1024 * 1024);
+// Disable the cache and drop all its entries. Regexps already compiled are not
+// affected.
+void DisableCompilationCache();
 
+class CacheCounters {
  public:
-  internal::RegexpInfo* rinfo_;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  size_t n_entries;
+  size_t size;
 };
+CacheCounters GetCompilationCacheCounters();
 
 }  // namespace regit
 
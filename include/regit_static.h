@@ -0,0 +1,519 @@
+#ifndef REGIT_STATIC_H_
+#define REGIT_STATIC_H_
+
+// Regexps compiled with the program, for regexps known at compile time.
+// Requires C++20.
+//
+//   regit::Static<"GET|POST"> re;
+//   re.MatchFull("GET");
+//
+// `Static` accepts the same syntax as `Regit`, and finds the same matches.
+// Regexps that `Regit` would fail to compile are rejected at compile time.
+// The regexp is parsed by the compiler, into tables that are constants of the
+// program, so there is no compilation at run time, and the matching code is
+// specialized for the regexp. Matching does not allocate, except for the
+// matches of `MatchAll()`.
+//
+// The tables hold a few bits per character of the regexp for each byte value,
+// so `Regit` is preferable for regexps of more than a few hundred characters.
+
+#if __cplusplus < 202002L
+#error "regit_static.h requires C++20."
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "regit.h"
+
+namespace regit {
+namespace internal {
+
+// A string literal that can be used as a template argument.
+template <size_t N>
+struct FixedString {
+  constexpr FixedString(const char (&string)[N]) {
+    for (size_t i = 0; i < N; i++) {
+      chars[i] = string[i];
+    }
+  }
+  // Like `Regit`, stop at the first null character.
+  constexpr size_t size() const {
+    size_t size = 0;
+    while ((size < N) && (chars[size] != '\0')) {
+      size++;
+    }
+    return size;
+  }
+
+  char chars[N];
+};
+
+
+// A set of positions of a `StaticAutomaton`.
+template <size_t kNWords>
+struct StaticBits {
+  constexpr bool Test(size_t i) const {
+    return (words[i / 64] >> (i % 64)) & 1;
+  }
+  constexpr void Set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+  constexpr bool Any() const {
+    for (size_t i = 0; i < kNWords; i++) {
+      if (words[i] != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+  // Call `f` with each position in the set.
+  template <typename F>
+  constexpr void ForEach(F f) const {
+    for (size_t i = 0; i < kNWords; i++) {
+      for (uint64_t word = words[i]; word != 0; word &= word - 1) {
+        f(i * 64 + std::countr_zero(word));
+      }
+    }
+  }
+
+  constexpr StaticBits& operator|=(const StaticBits& other) {
+    for (size_t i = 0; i < kNWords; i++) {
+      words[i] |= other.words[i];
+    }
+    return *this;
+  }
+  constexpr StaticBits operator&(const StaticBits& other) const {
+    StaticBits result;
+    for (size_t i = 0; i < kNWords; i++) {
+      result.words[i] = words[i] & other.words[i];
+    }
+    return result;
+  }
+  constexpr StaticBits operator~() const {
+    StaticBits result;
+    for (size_t i = 0; i < kNWords; i++) {
+      result.words[i] = ~words[i];
+    }
+    return result;
+  }
+  // Each position moved to the next one.
+  constexpr StaticBits Next() const {
+    StaticBits result;
+    for (size_t i = 0; i < kNWords; i++) {
+      result.words[i] = (words[i] << 1) | ((i > 0) ? words[i - 1] >> 63 : 0);
+    }
+    return result;
+  }
+  // Each position moved to the previous one.
+  constexpr StaticBits Previous() const {
+    StaticBits result;
+    for (size_t i = 0; i < kNWords; i++) {
+      result.words[i] =
+          (words[i] >> 1) | ((i + 1 < kNWords) ? words[i + 1] << 63 : 0);
+    }
+    return result;
+  }
+
+  uint64_t words[kNWords] = {};
+};
+
+
+// The number of characters matched by a regexp, counting periods. It can be
+// wrong for invalid regexps, which are rejected when parsing.
+constexpr size_t CountStaticPositions(const char* regexp, size_t size) {
+  size_t n_positions = 0;
+  for (size_t i = 0; i < size; i++) {
+    if (regexp[i] == '\\') {
+      i++;
+      n_positions++;
+    } else if ((regexp[i] != '(') && (regexp[i] != ')') &&
+               (regexp[i] != '|') && (regexp[i] != '?')) {
+      n_positions++;
+    }
+  }
+  return (n_positions != 0) ? n_positions : 1;
+}
+
+
+// The Glushkov automaton of a regexp: each character matched by the regexp is
+// a position, and the positions that can follow each other are linked. It is
+// matched like the `BitParallel` engine, with sets of positions instead of a
+// single `uint64_t`, so it handles regexps of any size.
+template <size_t kNPositions>
+class StaticAutomaton {
+ public:
+  static constexpr size_t kNWords = (kNPositions + 63) / 64;
+  typedef StaticBits<kNWords> Bits;
+
+  constexpr StaticAutomaton(const char* regexp, size_t size)
+      : status_(kSuccess), regexp_(regexp), size_(size), index_(0),
+        n_positions_(0), max_match_length_(0) {
+    Fragment fragment;
+    if (ParseAlternation(&fragment) && (index_ < size_)) {
+      // Only a closing parenthesis stops the alternation.
+      status_ = kParserMissingLeftParenthesis;
+    }
+    if ((status_ == kSuccess) && fragment.nullable) {
+      // Like `Regit`, reject the regexps matching the empty string.
+      status_ = kParserUnsupported;
+    }
+    if (status_ != kSuccess) {
+      return;
+    }
+    match_starts_ = fragment.first;
+    match_ends_ = fragment.last;
+    max_match_length_ = fragment.max_length;
+    for (size_t p = 0; p < n_positions_; p++) {
+      follow_[p].ForEach([this, p](size_t next) { precede_[next].Set(p); });
+    }
+    for (size_t p = 0; p < n_positions_; p++) {
+      if ((p + 1 < n_positions_) && IsSame(follow_[p], OnlyBit(p + 1))) {
+        follow_is_next_.Set(p);
+      }
+      if ((p > 0) && IsSame(precede_[p], OnlyBit(p - 1))) {
+        precede_is_previous_.Set(p);
+      }
+    }
+  }
+
+  constexpr Status status() const { return status_; }
+
+  constexpr bool MatchFull(const char* text, size_t text_size) const {
+    Bits allowed = match_starts_;
+    Bits active;
+    for (size_t i = 0; i < text_size; i++) {
+      active = allowed & masks_[static_cast<uint8_t>(text[i])];
+      if (!active.Any()) {
+        return false;
+      }
+      allowed = Follow(active);
+    }
+    return (active & match_ends_).Any();
+  }
+
+  constexpr bool MatchAnywhere(Match* match,
+                               const char* text, size_t text_size) const {
+    size_t end = FindEarliestEnd(text, 0, text_size);
+    if (end == kNoOffset) {
+      return false;
+    }
+    match->start = text + FindEarliestStart(text, 0, end);
+    match->end = text + end;
+    return true;
+  }
+
+  constexpr bool MatchFirst(Match* match,
+                            const char* text, size_t text_size) const {
+    return FindFirst(match, text, 0, text_size);
+  }
+
+  constexpr bool MatchAll(vector<Match>* matches,
+                          const char* text, size_t text_size) const {
+    bool has_matched = false;
+    Match match;
+    size_t from = 0;
+    while ((from < text_size) && FindFirst(&match, text, from, text_size)) {
+      matches->push_back(match);
+      has_matched = true;
+      from = match.end - text;
+    }
+    return has_matched;
+  }
+
+ private:
+  static constexpr size_t kNoOffset = SIZE_MAX;
+
+  // The positions a part of the regexp starts and ends with, the length of
+  // the longest text it matches, and whether it matches the empty string.
+  struct Fragment {
+    Bits first;
+    Bits last;
+    size_t max_length = 0;
+    bool nullable = false;
+  };
+
+  static constexpr Bits OnlyBit(size_t position) {
+    Bits bits;
+    bits.Set(position);
+    return bits;
+  }
+  static constexpr bool IsSame(const Bits& a, const Bits& b) {
+    for (size_t i = 0; i < kNWords; i++) {
+      if (a.words[i] != b.words[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Parsing. The functions return false when they have set an error status.
+
+  constexpr bool ParseAlternation(Fragment* fragment) {
+    if (!ParseConcatenation(fragment)) {
+      return false;
+    }
+    while ((index_ < size_) && (regexp_[index_] == '|')) {
+      index_++;
+      Fragment alternative;
+      if (!ParseConcatenation(&alternative)) {
+        return false;
+      }
+      fragment->first |= alternative.first;
+      fragment->last |= alternative.last;
+      fragment->nullable |= alternative.nullable;
+      fragment->max_length =
+          std::max(fragment->max_length, alternative.max_length);
+    }
+    return true;
+  }
+
+  constexpr bool ParseConcatenation(Fragment* fragment) {
+    bool empty = true;
+    while ((index_ < size_) &&
+           (regexp_[index_] != '|') && (regexp_[index_] != ')')) {
+      Fragment atom;
+      if (!ParseAtom(&atom)) {
+        return false;
+      }
+      while ((index_ < size_) && (regexp_[index_] == '?')) {
+        index_++;
+        atom.nullable = true;
+      }
+      if (empty) {
+        *fragment = atom;
+        empty = false;
+        continue;
+      }
+      fragment->last.ForEach([this, &atom](size_t p) {
+        follow_[p] |= atom.first;
+      });
+      if (fragment->nullable) {
+        fragment->first |= atom.first;
+      }
+      if (atom.nullable) {
+        fragment->last |= atom.last;
+      } else {
+        fragment->last = atom.last;
+      }
+      fragment->nullable = fragment->nullable && atom.nullable;
+      fragment->max_length += atom.max_length;
+    }
+    if (empty) {
+      status_ = kParserUnexpected;
+      return false;
+    }
+    return true;
+  }
+
+  constexpr bool ParseAtom(Fragment* fragment) {
+    char c = regexp_[index_++];
+    switch (c) {
+      case '(':
+        if (!ParseAlternation(fragment)) {
+          return false;
+        }
+        if (index_ == size_) {
+          status_ = kParserMissingRightParenthesis;
+          return false;
+        }
+        index_++;
+        return true;
+      case '.':
+        AddPosition(fragment, -1);
+        return true;
+      case '\\':
+        c = (index_ < size_) ? regexp_[index_++] : '\0';
+        switch (c) {
+          case '$': case '(': case ')': case '*': case '+': case '.':
+          case '?': case '[': case ']': case '^': case '{': case '|':
+          case '}': case '\\':
+            AddPosition(fragment, static_cast<uint8_t>(c));
+            return true;
+          default:
+            status_ = kParserUnexpected;
+            return false;
+        }
+      case '{': case '*': case '+': case '^': case '$': case '[':
+        status_ = kParserUnsupported;
+        return false;
+      case '?': case ']':
+        status_ = kParserUnexpected;
+        return false;
+      default:
+        AddPosition(fragment, static_cast<uint8_t>(c));
+        return true;
+    }
+  }
+
+  // Add a position matching `c`, or a period for -1.
+  constexpr void AddPosition(Fragment* fragment, int c) {
+    size_t position = n_positions_++;
+    for (int byte = 0; byte < 256; byte++) {
+      if ((c == -1) ? (byte != '\n' && byte != '\r') : (byte == c)) {
+        masks_[byte].Set(position);
+      }
+    }
+    fragment->first = OnlyBit(position);
+    fragment->last = OnlyBit(position);
+    fragment->max_length = 1;
+  }
+
+  // Matching. Offsets are relative to `text`.
+
+  // The positions that can match the character after the positions in
+  // `positions`.
+  constexpr Bits Follow(const Bits& positions) const {
+    Bits next = (positions & follow_is_next_).Next();
+    (positions & ~follow_is_next_).ForEach([this, &next](size_t p) {
+      next |= follow_[p];
+    });
+    return next;
+  }
+  // The positions that can match the character before the positions in
+  // `positions`.
+  constexpr Bits Precede(const Bits& positions) const {
+    Bits previous = (positions & precede_is_previous_).Previous();
+    (positions & ~precede_is_previous_).ForEach([this, &previous](size_t p) {
+      previous |= precede_[p];
+    });
+    return previous;
+  }
+
+  // The earliest end of a match in [`begin`, `end`), or `kNoOffset`.
+  constexpr size_t FindEarliestEnd(const char* text,
+                                   size_t begin, size_t end) const {
+    Bits allowed = match_starts_;
+    for (size_t i = begin; i < end; i++) {
+      Bits active = allowed & masks_[static_cast<uint8_t>(text[i])];
+      if ((active & match_ends_).Any()) {
+        return i + 1;
+      }
+      allowed = Follow(active);
+      allowed |= match_starts_;
+    }
+    return kNoOffset;
+  }
+
+  // The earliest start, not before `from`, of a match ending at `end`. There
+  // must be one.
+  constexpr size_t FindEarliestStart(const char* text,
+                                     size_t from, size_t end) const {
+    size_t start = kNoOffset;
+    Bits allowed = match_ends_;
+    for (size_t i = end; (i > from) && allowed.Any(); i--) {
+      Bits active = allowed & masks_[static_cast<uint8_t>(text[i - 1])];
+      if ((active & match_starts_).Any()) {
+        start = i - 1;
+      }
+      allowed = Precede(active);
+    }
+    return start;
+  }
+
+  // The latest end, not after `end`, of a match starting in
+  // [`begin`, `last_start`].
+  constexpr size_t FindLatestEnd(const char* text, size_t begin,
+                                 size_t last_start, size_t end) const {
+    size_t latest_end = kNoOffset;
+    Bits allowed;
+    for (size_t i = begin; i < end; i++) {
+      if (i <= last_start) {
+        allowed |= match_starts_;
+      } else if (!allowed.Any()) {
+        break;
+      }
+      Bits active = allowed & masks_[static_cast<uint8_t>(text[i])];
+      if ((active & match_ends_).Any()) {
+        latest_end = i + 1;
+      }
+      allowed = Follow(active);
+    }
+    return latest_end;
+  }
+
+  // Like `Simulation::MatchFirst()`: among the matches starting at or before
+  // the start of the match ending first, prefer the one ending last, and then
+  // the one starting first.
+  constexpr bool FindFirst(Match* match, const char* text,
+                           size_t from, size_t text_size) const {
+    size_t first_end = FindEarliestEnd(text, from, text_size);
+    if (first_end == kNoOffset) {
+      return false;
+    }
+    size_t first_start = FindEarliestStart(text, from, first_end);
+    size_t begin = first_end - std::min(max_match_length_, first_end - from);
+    size_t end = FindLatestEnd(text, begin, first_start, text_size);
+    match->start = text + FindEarliestStart(text, from, end);
+    match->end = text + end;
+    return true;
+  }
+
+  Status status_;
+  const char* regexp_;
+  size_t size_;
+  // The parsing position in `regexp_`.
+  size_t index_;
+
+  size_t n_positions_;
+  // The positions matching each character.
+  Bits masks_[256];
+  Bits match_starts_;
+  Bits match_ends_;
+  Bits follow_[kNPositions];
+  Bits precede_[kNPositions];
+  // The positions followed (or preceded) only by the next (or previous) one,
+  // as in literals, handled with a shift.
+  Bits follow_is_next_;
+  Bits precede_is_previous_;
+  size_t max_match_length_;
+};
+
+}  // namespace internal
+
+
+template <internal::FixedString kRegexp>
+class Static {
+ public:
+  static constexpr bool MatchFull(const string& text) {
+    return MatchFull(text.data(), text.size());
+  }
+  static constexpr bool MatchFull(const char* text, size_t text_size) {
+    return kAutomaton.MatchFull(text, text_size);
+  }
+  static constexpr bool MatchAnywhere(Match* match, const string& text) {
+    return MatchAnywhere(match, text.data(), text.size());
+  }
+  static constexpr bool MatchAnywhere(Match* match,
+                                      const char* text, size_t text_size) {
+    return kAutomaton.MatchAnywhere(match, text, text_size);
+  }
+  static constexpr bool MatchFirst(Match* match, const string& text) {
+    return MatchFirst(match, text.data(), text.size());
+  }
+  static constexpr bool MatchFirst(Match* match,
+                                   const char* text, size_t text_size) {
+    return kAutomaton.MatchFirst(match, text, text_size);
+  }
+  static constexpr bool MatchAll(vector<Match>* matches, const string& text) {
+    return MatchAll(matches, text.data(), text.size());
+  }
+  static constexpr bool MatchAll(vector<Match>* matches,
+                                 const char* text, size_t text_size) {
+    return kAutomaton.MatchAll(matches, text, text_size);
+  }
+
+ private:
+  static constexpr internal::StaticAutomaton<internal::CountStaticPositions(
+      kRegexp.chars, kRegexp.size())>
+      kAutomaton{kRegexp.chars, kRegexp.size()};
+  static_assert(kAutomaton.status() == kSuccess,
+                "The regexp is not supported by regit.");
+};
+
+
+}  // namespace regit
+
+#endif  // REGIT_STATIC_H_
@@ -30,6 +30,7 @@ int main(int argc, const char* argv[]) {
   const char* text = argv[2];
 
   regit::Regit re(regexp);
+  re.Compile();
   if (re.status() != regit::kSuccess) {
     return EXIT_FAILURE;
   }
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <deque>
+
+#include "aho_corasick.h"
+
+namespace regit {
+namespace internal {
+
+constexpr size_t AhoCorasick::kMaxLiterals;
+constexpr size_t AhoCorasick::kMaxLiteralsSize;
+constexpr size_t AhoCorasick::kMaxTransitions;
+constexpr uint32_t AhoCorasick::kMatchFlag;
+constexpr uint32_t AhoCorasick::kRoot;
+
+
+// Append to `literals` the texts matched from `state` to the exit state,
+// prefixed with `path`.
+static bool CollectPaths(vector<string>* literals, size_t* literals_size,
+                         string* path, const Program* program, int state) {
+  if (state == program->exit_state()) {
+    *literals_size += path->size();
+    if ((literals->size() == AhoCorasick::kMaxLiterals) ||
+        (*literals_size > AhoCorasick::kMaxLiteralsSize)) {
+      return false;
+    }
+    literals->push_back(*path);
+  }
+  for (const Program::Transition* transition =
+           program->transitions_begin(state);
+       transition < program->transitions_end(state);
+       transition++) {
+    if (transition->kind == Program::kPeriodTransition) {
+      return false;
+    }
+    size_t path_size = path->size();
+    path->append(program->literal(transition), transition->length);
+    if (!CollectPaths(literals, literals_size, path, program,
+                      transition->exit)) {
+      return false;
+    }
+    path->resize(path_size);
+  }
+  return true;
+}
+
+
+bool AhoCorasick::CollectLiterals(vector<string>* literals,
+                                  const Program* program) {
+  string path;
+  size_t literals_size = 0;
+  if (!CollectPaths(literals, &literals_size, &path, program,
+                    program->entry_state())) {
+    return false;
+  }
+  std::sort(literals->begin(), literals->end());
+  literals->erase(std::unique(literals->begin(), literals->end()),
+                  literals->end());
+  return true;
+}
+
+
+AhoCorasick* AhoCorasick::Build(const Program* program) {
+  vector<string> literals;
+  if (!CollectLiterals(&literals, program) || literals.empty()) {
+    return nullptr;
+  }
+  // The literals are sorted, so each one adds a state for each character
+  // after its common prefix with the previous one.
+  size_t n_states = 1;
+  bool used[256] = {false};
+  for (size_t i = 0; i < literals.size(); i++) {
+    const string& literal = literals[i];
+    size_t common = 0;
+    if (i != 0) {
+      const string& previous = literals[i - 1];
+      while ((common < previous.size()) && (common < literal.size()) &&
+             (previous[common] == literal[common])) {
+        common++;
+      }
+    }
+    n_states += literal.size() - common;
+    for (char c : literal) {
+      used[static_cast<uint8_t>(c)] = true;
+    }
+  }
+  size_t n_classes = 1 + std::count(used, used + 256, true);
+  if (n_states * n_classes > kMaxTransitions) {
+    return nullptr;
+  }
+  return new AhoCorasick(literals);
+}
+
+
+AhoCorasick::AhoCorasick(const vector<string>& literals)
+    : n_literals_(literals.size()), n_classes_(1), max_match_length_(0),
+      teddy_(Teddy::Build(literals)) {
+  // Class 0 holds the characters that appear in no literal. They lead back to
+  // the root from all states.
+  memset(byte_classes_, 0, sizeof(byte_classes_));
+  for (const string& literal : literals) {
+    for (char c : literal) {
+      uint8_t byte = static_cast<uint8_t>(c);
+      if (byte_classes_[byte] == 0) {
+        byte_classes_[byte] = n_classes_++;
+      }
+    }
+    max_match_length_ = max(max_match_length_, literal.size());
+  }
+
+  // Build the trie. Missing transitions are marked with `kMatchFlag`, which
+  // cannot be a valid state offset yet.
+  const uint32_t kMissing = kMatchFlag;
+  transitions_.assign(n_classes_, kMissing);
+  depths_.push_back(0);
+  vector<bool> terminals(1, false);
+  for (const string& literal : literals) {
+    uint32_t state = kRoot;
+    for (char c : literal) {
+      uint32_t* next = &transitions_[state + byte_classes_[
+          static_cast<uint8_t>(c)]];
+      if (*next == kMissing) {
+        *next = transitions_.size();
+        depths_.push_back(depths_[Index(state)] + 1);
+        terminals.push_back(false);
+        transitions_.resize(transitions_.size() + n_classes_, kMissing);
+        // `next` may have been invalidated.
+        state = transitions_[state + byte_classes_[static_cast<uint8_t>(c)]];
+      } else {
+        state = *next;
+      }
+    }
+    terminals[Index(state)] = true;
+  }
+
+  // Complete the transitions in breadth-first order, so that the rows of the
+  // failure states, which are shallower, are complete when they are used.
+  match_lengths_.assign(depths_.size(), 0);
+  vector<uint32_t> failures(depths_.size(), kRoot);
+  std::deque<uint32_t> queue;
+  queue.push_back(kRoot);
+  while (!queue.empty()) {
+    uint32_t state = queue.front();
+    queue.pop_front();
+    uint32_t failure = failures[Index(state)];
+    for (size_t c = 0; c < n_classes_; c++) {
+      uint32_t* next = &transitions_[state + c];
+      uint32_t fallback =
+          (state == kRoot) ? kRoot : transitions_[failure + c];
+      if (*next == kMissing) {
+        *next = fallback;
+        continue;
+      }
+      size_t index = Index(*next);
+      failures[index] = fallback & ~kMatchFlag;
+      match_lengths_[index] = terminals[index] ?
+          depths_[index] : match_lengths_[Index(failures[index])];
+      queue.push_back(*next);
+      if (match_lengths_[index] != 0) {
+        *next |= kMatchFlag;
+      }
+    }
+  }
+}
+
+
+pos_t AhoCorasick::FindEarliestEnd(pos_t* start,
+                                   const char* begin, const char* end) const {
+  // No match starts before the first occurrence of a literal.
+  if (FLAG_use_teddy && (teddy_ != nullptr)) {
+    begin = teddy_->Find(begin, end);
+    if (begin == kInvalidPos) {
+      return kInvalidPos;
+    }
+  }
+  uint32_t state = kRoot;
+  for (const char* p = begin; p < end; p++) {
+    state = Next(state, *p);
+    if (state & kMatchFlag) {
+      *start = p + 1 - match_lengths_[Index(state & ~kMatchFlag)];
+      return p + 1;
+    }
+  }
+  return kInvalidPos;
+}
+
+
+pos_t AhoCorasick::FindLongestAt(const char* start,
+                                 const char* text_end) const {
+  // Only follow the transitions of the trie: a transition to a state that is
+  // not one character deeper is a failure transition.
+  pos_t longest = kInvalidPos;
+  uint32_t state = kRoot;
+  for (const char* p = start; p < text_end; p++) {
+    state = Next(state, *p) & ~kMatchFlag;
+    size_t index = Index(state);
+    if (depths_[index] != static_cast<size_t>(p + 1 - start)) {
+      break;
+    }
+    if (match_lengths_[index] == depths_[index]) {
+      longest = p + 1;
+    }
+  }
+  return longest;
+}
+
+
+bool AhoCorasick::MatchFull(const char* text, size_t text_size) const {
+  pos_t end = FindLongestAt(text, text + text_size);
+  return (end != kInvalidPos) && (end == text + text_size);
+}
+
+
+bool AhoCorasick::MatchAnywhere(Match* match,
+                                const char* text, size_t text_size) const {
+  pos_t start;
+  pos_t end = FindEarliestEnd(&start, text, text + text_size);
+  if (end == kInvalidPos) {
+    return false;
+  }
+  match->start = start;
+  match->end = end;
+  return true;
+}
+
+
+bool AhoCorasick::MatchFirst(Match* match,
+                             const char* text, size_t text_size) const {
+  // Like `Simulation::MatchFirst()`: among the matches starting at or before
+  // the start of the match ending first, prefer the one ending last, and then
+  // the one starting first.
+  const char* text_end = text + text_size;
+  pos_t first_start;
+  pos_t first_end = FindEarliestEnd(&first_start, text, text_end);
+  if (first_end == kInvalidPos) {
+    return false;
+  }
+  // No match ends before `first_end`, so no match of interest starts more than
+  // `max_match_length_` characters before it.
+  const char* begin =
+      first_end - min(max_match_length_,
+                      static_cast<size_t>(first_end - text));
+  match->end = kInvalidPos;
+  for (const char* start = begin; start <= first_start; start++) {
+    pos_t end = FindLongestAt(start, text_end);
+    if ((end != kInvalidPos) &&
+        ((match->end == kInvalidPos) || (end > match->end))) {
+      match->start = start;
+      match->end = end;
+    }
+  }
+  ASSERT(match->end >= first_end);
+  return true;
+}
+
+
+bool AhoCorasick::MatchAll(vector<Match>* matches,
+                           const char* text, size_t text_size) const {
+  bool has_matched = false;
+  Match match;
+  const char* text_end = text + text_size;
+  while ((text < text_end) && MatchFirst(&match, text, text_end - text)) {
+    matches->push_back(match);
+    has_matched = true;
+    text = match.end;
+  }
+  return has_matched;
+}
+
+
+} }  // namespace regit::internal
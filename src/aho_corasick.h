@@ -0,0 +1,98 @@
+#ifndef REGIT_AHO_CORASICK_H_
+#define REGIT_AHO_CORASICK_H_
+
+#include <string>
+#include <vector>
+
+#include "globals.h"
+#include "program.h"
+#include "regit.h"
+#include "teddy.h"
+
+namespace regit {
+namespace internal {
+
+// An Aho-Corasick automaton, for regexps that only match a set of literals,
+// like alternations of literals, possibly nested in concatenations with other
+// literals (`ab(cd|ef)`).
+//
+// The trie of the literals, completed with the failure transitions, is stored
+// as a dense DFA over byte classes: bytes that appear in no literal share a
+// class. Like in the `DFA`, states are the offsets of their rows of
+// transitions. The transitions to the states where a literal ends are flagged
+// with `kMatchFlag`, so that scanning costs a table lookup and a test per byte.
+//
+// Scanning finds the earliest end of a match, and the longest literal ending
+// there. With few literals, `Teddy` first skips to the first occurrence of a
+// literal. The other matches considered by `MatchFirst()` start shortly before,
+// and are found by walking the trie from each of their possible starts.
+class AhoCorasick {
+ public:
+  // The limits over which the engine is not built.
+  static constexpr size_t kMaxLiterals = 64 * 1024;
+  static constexpr size_t kMaxLiteralsSize = 1024 * 1024;
+  static constexpr size_t kMaxTransitions = 4 * 1024 * 1024;
+
+  // Returns nullptr if the program does not only match literals, or if the
+  // automaton would be too large.
+  static AhoCorasick* Build(const Program* program);
+  ~AhoCorasick() { delete teddy_; }
+
+  bool MatchFull(const char* text, size_t text_size) const;
+  bool MatchAnywhere(Match* match, const char* text, size_t text_size) const;
+  bool MatchFirst(Match* match, const char* text, size_t text_size) const;
+  bool MatchAll(vector<Match>* matches,
+                const char* text, size_t text_size) const;
+
+  size_t n_literals() const { return n_literals_; }
+  size_t n_states() const { return depths_.size(); }
+  size_t n_classes() const { return n_classes_; }
+  // The memory used by the tables, in bytes.
+  size_t size() const {
+    return sizeof(*this) +
+        transitions_.size() * sizeof(uint32_t) +
+        (depths_.size() + match_lengths_.size()) * sizeof(uint32_t) +
+        ((teddy_ != nullptr) ? teddy_->size() : 0);
+  }
+
+ private:
+  static constexpr uint32_t kMatchFlag = 1u << 31;
+  static constexpr uint32_t kRoot = 0;
+
+  explicit AhoCorasick(const vector<string>& literals);
+
+  // Collect the texts matched by the program, sorted and without duplicates.
+  // Returns false if the program matches a period, or too many texts.
+  static bool CollectLiterals(vector<string>* literals,
+                              const Program* program);
+
+  uint32_t Next(uint32_t state, char c) const {
+    return transitions_[state + byte_classes_[static_cast<uint8_t>(c)]];
+  }
+  size_t Index(uint32_t state) const { return state / n_classes_; }
+
+  // Scan [`begin`, `end`) for the earliest end of a match, and set `*start` to
+  // the start of the longest match ending there. Returns `kInvalidPos` if
+  // there is no match.
+  pos_t FindEarliestEnd(pos_t* start, const char* begin, const char* end) const;
+  // The end of the longest literal at `start`, or `kInvalidPos`.
+  pos_t FindLongestAt(const char* start, const char* text_end) const;
+
+  size_t n_literals_;
+  size_t n_classes_;
+  uint8_t byte_classes_[256];
+  vector<uint32_t> transitions_;
+  // For each state, the length of the text leading to it from the root, and
+  // the length of the longest literal ending there, or 0.
+  vector<uint32_t> depths_;
+  vector<uint32_t> match_lengths_;
+  size_t max_match_length_;
+  const Teddy* teddy_;
+
+  DISALLOW_COPY_AND_ASSIGN(AhoCorasick);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_AHO_CORASICK_H_
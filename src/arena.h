@@ -0,0 +1,140 @@
+#ifndef REGIT_ARENA_H_
+#define REGIT_ARENA_H_
+
+#include <new>
+#include <stdlib.h>
+#include <utility>
+#include <vector>
+
+#include "globals.h"
+
+namespace regit {
+namespace internal {
+
+// A bump allocator.
+// Memory is carved from chunks of increasing sizes, and only released all at
+// once when the arena is destroyed. Destructors of objects allocated in the
+// arena are never called, so they must not own any memory outside of it.
+class Arena {
+ public:
+  Arena()
+      : chunks_(nullptr), current_(nullptr), end_(nullptr),
+        size_(0), next_chunk_size_(kInitialChunkSize) {}
+  ~Arena() {
+    while (chunks_ != nullptr) {
+      Chunk* next = chunks_->next;
+      free(chunks_);
+      chunks_ = next;
+    }
+  }
+
+  // Returns nullptr if the memory cannot be allocated.
+  void* Allocate(size_t size, size_t alignment) {
+    ASSERT((alignment & (alignment - 1)) == 0);
+    char* aligned = AlignUp(current_, alignment);
+    if ((current_ == nullptr) || (aligned + size > end_)) {
+      if (!NewChunk(size + alignment)) {
+        return nullptr;
+      }
+      aligned = AlignUp(current_, alignment);
+    }
+    current_ = aligned + size;
+    return aligned;
+  }
+
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    void* memory = Allocate(sizeof(T), alignof(T));
+    if (memory == nullptr) {
+      return nullptr;
+    }
+    return new(memory) T(std::forward<Args>(args)...);
+  }
+
+  // The memory reserved by the arena, in bytes.
+  size_t size() const { return size_; }
+
+ private:
+  static constexpr size_t kInitialChunkSize = 512;
+  static constexpr size_t kMaxChunkSize = 64 * 1024;
+
+  struct Chunk {
+    Chunk* next;
+  };
+
+  static char* AlignUp(char* pointer, size_t alignment) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+    return reinterpret_cast<char*>((address + alignment - 1) & ~(alignment - 1));
+  }
+
+  bool NewChunk(size_t min_size) {
+    size_t chunk_size = next_chunk_size_;
+    if (chunk_size < sizeof(Chunk) + min_size) {
+      chunk_size = sizeof(Chunk) + min_size;
+    } else if (next_chunk_size_ < kMaxChunkSize) {
+      next_chunk_size_ *= 2;
+    }
+    Chunk* chunk = reinterpret_cast<Chunk*>(malloc(chunk_size));
+    if (chunk == nullptr) {
+      return false;
+    }
+    chunk->next = chunks_;
+    chunks_ = chunk;
+    current_ = reinterpret_cast<char*>(chunk + 1);
+    end_ = reinterpret_cast<char*>(chunk) + chunk_size;
+    size_ += chunk_size;
+    return true;
+  }
+
+  Chunk* chunks_;
+  char* current_;
+  char* end_;
+  size_t size_;
+  size_t next_chunk_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(Arena);
+};
+
+
+// An allocator for standard containers, allocating from an arena.
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+
+  explicit ArenaAllocator(Arena* arena) : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    T* memory = static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+    if (memory == nullptr) {
+      throw std::bad_alloc();
+    }
+    return memory;
+  }
+  // The memory is released with the arena.
+  void deallocate(T*, size_t) {}
+
+  Arena* arena() const { return arena_; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena();
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return arena_ != other.arena();
+  }
+
+ private:
+  Arena* arena_;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_ARENA_H_
@@ -12,14 +12,89 @@ void Automaton::BuildFrom(Regexp* regexp) {
   last_state_ = entry_state_;
   exit_state_ = entry_state_;
   indexer.Visit(regexp);
+  exit_states_.push_back(exit_state_);
+  ComputeEpsilonClosures();
+  CheckEmptyMatches();
 
   if (FLAG_print_automaton) {
     Print();
   }
 }
 
+
+void Automaton::BuildFrom(const vector<Regexp*>& regexps) {
+  RegexpIndexer indexer(this);
+  entry_state_ = NewState();
+  last_state_ = entry_state_;
+  for (Regexp* regexp : regexps) {
+    State* exit = NewState();
+    indexer.Visit(regexp, entry_state_, exit);
+    exit_states_.push_back(exit);
+  }
+  exit_state_ = nullptr;
+  ComputeEpsilonClosures();
+  CheckEmptyMatches();
+
+  if (FLAG_print_automaton) {
+    Print();
+  }
+}
+
+void Automaton::ComputeEpsilonClosures() {
+  // A depth-first search from each state, following the epsilon transitions.
+  // `visited` holds the index of the state whose closure is being computed.
+  vector<int> visited(states_.size(), -1);
+  vector<const State*> stack;
+  epsilon_closure_offsets_.reserve(states_.size() + 1);
+  for (const State* state : states_) {
+    epsilon_closure_offsets_.push_back(epsilon_closures_.size());
+    visited[state->index()] = state->index();
+    stack.push_back(state);
+    while (!stack.empty()) {
+      const State* current = stack.back();
+      stack.pop_back();
+      epsilon_closures_.push_back(current->index());
+      for (const Regexp* regexp : *current->from()) {
+        const State* next = regexp->exit();
+        if (regexp->IsEpsilon() && (visited[next->index()] != state->index())) {
+          visited[next->index()] = state->index();
+          stack.push_back(next);
+        }
+      }
+    }
+  }
+  epsilon_closure_offsets_.push_back(epsilon_closures_.size());
+}
+
+
+bool Automaton::InEpsilonClosure(const State* state,
+                                 const State* target) const {
+  for (const uint32_t* it = epsilon_closure_begin(state);
+       it < epsilon_closure_end(state);
+       it++) {
+    if (static_cast<int>(*it) == target->index()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+void Automaton::CheckEmptyMatches() {
+  if (status_ != kSuccess) {
+    return;
+  }
+  for (const State* exit : exit_states_) {
+    if (InEpsilonClosure(entry_state_, exit)) {
+      status_ = kParserUnsupported;
+      return;
+    }
+  }
+}
+
+
 State* Automaton::NewState() {
-  State* state = new State();
+  State* state = arena_->New<State>(arena_);
   if (state == nullptr) {
     status_ = kOutOfMemory;
   }
@@ -49,9 +124,17 @@ void Automaton::Print() const {
 
 void Automaton::PrintInfo() const {
   cout << "  // Number of states: " << NStates() << "\n"
-      << "  // Entry state: " << entry_state()->index() << "\n"
-      << "  // Exit state: " << exit_state()->index() << "\n"
-      << "  // Max transition match length: " << max_transition_match_length()
+      << "  // Entry state: " << entry_state()->index() << "\n";
+  if (exit_state() != nullptr) {
+    cout << "  // Exit state: " << exit_state()->index() << "\n";
+  } else {
+    cout << "  // Exit states:";
+    for (const State* exit : exit_states_) {
+      cout << " " << exit->index();
+    }
+    cout << "\n";
+  }
+  cout << "  // Max transition match length: " << max_transition_match_length()
       << "\n";
 }
 
@@ -89,12 +172,12 @@ void RegexpIndexer::VisitAlternation(Alternation* alternation,
 void RegexpIndexer::VisitConcatenation(Concatenation* concatenation,
                                        State* entry_state,
                                        State* exit_state) {
-  const vector<Regexp*>* sub_regexps = concatenation->sub_regexps();
+  const ArenaVector<Regexp*>* sub_regexps = concatenation->sub_regexps();
   ASSERT(!sub_regexps->empty());
   State* previous_exit = (entry_state != nullptr) ? entry_state
                                                   : automaton_->last_state_;
   State* exit;
-  for (vector<Regexp*>::const_iterator it = sub_regexps->cbegin();
+  for (ArenaVector<Regexp*>::const_iterator it = sub_regexps->cbegin();
        it < sub_regexps->cend() - 1;
        it++) {
     exit = automaton_->NewState();
@@ -106,191 +189,4 @@ void RegexpIndexer::VisitConcatenation(Concatenation* concatenation,
 }
 
 
-bool Simulation::MatchFull(const char* text, size_t text_size) {
-  text_ = text;
-  text_end_ = text + text_size;
-  current_pos_ = text_;
-  current_tick_ = 0;
-
-  SetState(text, automaton_->entry_state(), 0);
-
-  while (remaining_text_size() != 0) {
-    for (const State* state : *automaton_->states()) {
-      pos_t state_pos = GetState(state, 0);
-      if (state_pos != kInvalidPos) {
-        for (const Regexp* regexp : *state->from()) {
-          int chars_matched = regexp->Match(current_pos_);
-          if (chars_matched != -1) {
-            UpdateState(state_pos, regexp->exit(), chars_matched);
-          }
-        }
-      }
-    }
-    if (FLAG_trace_matching) { Print(); }
-    InvalidateTick(0);
-    Advance(1);
-  }
-
-  if (FLAG_trace_matching) { Print(); }
-  return GetState(automaton_->exit_state(), 0) != kInvalidPos;
-}
-
-
-bool Simulation::MatchAnywhere(Match* match, const char* text, size_t text_size) {
-  text_ = text;
-  text_end_ = text + text_size;
-  current_pos_ = text_;
-  current_tick_ = 0;
-
-  while (remaining_text_size() != 0) {
-    SetState(current_pos_, automaton_->entry_state(), 0);
-    for (const State* state : *automaton_->states()) {
-      pos_t state_pos = GetState(state, 0);
-      if (state_pos != kInvalidPos) {
-        for (const Regexp* regexp : *state->from()) {
-          int chars_matched = regexp->Match(current_pos_);
-          if (chars_matched != -1) {
-            UpdateState(state_pos, regexp->exit(), chars_matched);
-          }
-        }
-      }
-    }
-    if (FLAG_trace_matching) { Print(); }
-    InvalidateTick(0);
-    Advance(1);
-    pos_t found_pos = GetState(automaton_->exit_state(), 0);
-    if (found_pos != kInvalidPos) {
-      match->start = found_pos;
-      match->end = current_pos_;
-      return true;
-    }
-  }
-
-  if (FLAG_trace_matching) { Print(); }
-  return false;
-}
-
-
-bool Simulation::MatchFirst(Match* match, const char* text, size_t text_size) {
-  text_ = text;
-  text_end_ = text + text_size;
-  current_pos_ = text_;
-  current_tick_ = 0;
-
-  bool found_match = false;
-
-  while (remaining_text_size() != 0) {
-    if (!found_match) {
-      SetState(current_pos_, automaton_->entry_state(), 0);
-    }
-    for (const State* state : *automaton_->states()) {
-      pos_t state_pos = GetState(state, 0);
-      if (state_pos != kInvalidPos) {
-        for (const Regexp* regexp : *state->from()) {
-          int chars_matched = regexp->Match(current_pos_);
-          if (chars_matched != -1) {
-            UpdateState(state_pos, regexp->exit(), chars_matched);
-          }
-        }
-      }
-    }
-    if (FLAG_trace_matching) { Print(); }
-    InvalidateTick(0);
-    Advance(1);
-    pos_t found_pos = GetState(automaton_->exit_state(), 0);
-    if (found_pos != kInvalidPos) {
-      // Any newly found match must be preferable to the previously found match.
-      ASSERT(!found_match || (found_pos <= match->start));
-      ASSERT(!found_match || (current_pos_ >= match->end));
-      if (!found_match) {
-        InvalidateStatesAfter(found_pos);
-      }
-      found_match = true;
-      match->start = found_pos;
-      match->end = current_pos_;
-    }
-  }
-
-  if (FLAG_trace_matching) { Print(); }
-  return found_match;
-}
-
-
-bool Simulation::MatchAll(vector<Match>* matches, const char* text, size_t text_size) {
-  bool found_match;
-  bool has_matched = false;
-  Match match;
-  do {
-    found_match = MatchFirst(&match, text, text_size);
-    if (found_match) {
-      matches->push_back(match);
-      has_matched = true;
-      text_size -= (match.end - text);
-      text = match.end;
-    }
-  } while (found_match && (text_size != 0));
-  return has_matched;
-}
-
-
-void Simulation::InvalidateStatesAfter(pos_t start) {
-  for (int tick = 0; tick < n_ticks_; tick++) {
-    for (const State* state : *automaton_->states()) {
-      if (GetState(state, tick) > start) {
-        InvalidateState(state, tick);
-      }
-    }
-  }
-}
-
-
-void Simulation::Print(int tick) const {
-  RegexpPrinter printer(RegexpPrinter::kShortName);
-
-#define ACTIVE_STYLE_INITIAL    "style=bold,color=blue"
-#define ACTIVE_STYLE_TRANSITION "style=bold,color=orange"
-#define ACTIVE_STYLE_FUTURE     ACTIVE_STYLE_TRANSITION
-#define INACTIVE_STYLE          "style=\"\",color=\"\""
-
-  int current_offset = CurrentOffset();
-  cout << "digraph trace_" << current_offset << "_" << tick << " {\n"
-      << "  label=\"offset " << current_offset << " tick " << tick << "\\n"
-      <<            "text: " << current_pos_ + tick << "\";\n"
-      << "  labelloc=t;\n"
-      << "  rankdir=\"LR\";  // We prefer an horizontal graph.\n";
-  automaton_->PrintInfo();
-
-  for (const State* state : *automaton_->states()) {
-    pos_t pos = GetState(state, tick);
-    if (pos != kInvalidPos) {
-      cout << "  node [label=\"" <<  pos - text_ << "\",";
-      if (tick == 0) {
-        cout << ACTIVE_STYLE_INITIAL "]; ";
-      } else {
-        cout << ACTIVE_STYLE_FUTURE "]; ";
-      }
-    } else {
-      cout << "  node [label=\"\"," << INACTIVE_STYLE "]; ";
-    }
-    cout << state->index() << ";\n";
-  }
-  cout << "  // Transitions.\n";
-  cout << "  node [" INACTIVE_STYLE "];\n";
-  for (const State* state : *automaton_->states()) {
-    bool active_state = GetState(state, tick) != kInvalidPos;
-    for (const Regexp* regexp : *state->from()) {
-      cout << "  " << state->index() << " -> " << regexp->exit()->index()
-          << " [label=\"";
-      printer.Visit(regexp);
-      cout << "\"";
-      if (active_state && (tick == 0) && (-1 != regexp->Match(current_pos_))) {
-        cout << "," ACTIVE_STYLE_TRANSITION;
-      }
-      cout << "];\n";
-    }
-  }
-  cout << "}\n";
-}
-
-
 } }  // namespace regit::internal
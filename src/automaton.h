@@ -3,6 +3,7 @@
 
 #include <vector>
 
+#include "arena.h"
 #include "regexp.h"
 #include "regexp_visitor.h"
 #include "regit.h"
@@ -13,44 +14,66 @@ namespace internal {
 class RegexpIndexer;
 
 
+// States are allocated in the arena of their automaton.
 class State {
  public:
-  State() {}
+  explicit State(Arena* arena)
+      : from_(ArenaAllocator<const Regexp*>(arena)),
+        to_(ArenaAllocator<const Regexp*>(arena)) {}
 
   int index() const { return index_; }
   void set_index(int index) { index_ = index; }
 
-  const vector<const Regexp*>* from() const {
+  const ArenaVector<const Regexp*>* from() const {
     return &from_;
   }
-  const vector<const Regexp*>* to() const {
+  const ArenaVector<const Regexp*>* to() const {
     return &to_;
   }
 
  private:
   int index_;
-  vector<const Regexp*> from_;
-  vector<const Regexp*> to_;
+  ArenaVector<const Regexp*> from_;
+  ArenaVector<const Regexp*> to_;
 
   friend class RegexpIndexer;
 };
 
 
+// The automaton and its states are allocated in `arena`.
 class Automaton {
  public:
-  explicit Automaton(Regexp* regexp)
+  Automaton(Regexp* regexp, Arena* arena)
       : entry_state_(nullptr), exit_state_(nullptr), last_state_(nullptr),
+        states_(ArenaAllocator<State*>(arena)),
+        exit_states_(ArenaAllocator<State*>(arena)),
+        epsilon_closure_offsets_(ArenaAllocator<uint32_t>(arena)),
+        epsilon_closures_(ArenaAllocator<uint32_t>(arena)),
         max_transition_match_length_(0),
+        arena_(arena),
         status_(kSuccess) {
     BuildFrom(regexp);
   }
-  ~Automaton() {
-    for (State* state : states_) {
-      delete state;
-    }
+  // The automaton of a set of regexps. They share the entry state, and each
+  // has its own exit state. `exit_state()` is then meaningless.
+  Automaton(const vector<Regexp*>& regexps, Arena* arena)
+      : entry_state_(nullptr), exit_state_(nullptr), last_state_(nullptr),
+        states_(ArenaAllocator<State*>(arena)),
+        exit_states_(ArenaAllocator<State*>(arena)),
+        epsilon_closure_offsets_(ArenaAllocator<uint32_t>(arena)),
+        epsilon_closures_(ArenaAllocator<uint32_t>(arena)),
+        max_transition_match_length_(0),
+        arena_(arena),
+        status_(kSuccess) {
+    BuildFrom(regexps);
   }
 
   void BuildFrom(Regexp* regexp);
+  void BuildFrom(const vector<Regexp*>& regexps);
+  void ComputeEpsilonClosures();
+  // Reject the regexps matching the empty string, as matches are never empty,
+  // with `kParserUnsupported`.
+  void CheckEmptyMatches();
 
   void IndexStates();
 
@@ -59,7 +82,26 @@ class Automaton {
   int NStates() const { return states_.size(); }
   const State* entry_state() const { return entry_state_; }
   const State* exit_state() const { return exit_state_; }
-  const vector<State*>* states() const { return &states_; }
+  // The exit states of the regexps, in order. There is one for a single regexp.
+  const ArenaVector<State*>* exit_states() const { return &exit_states_; }
+  const ArenaVector<State*>* states() const { return &states_; }
+
+  // The indexes of the states reachable from `state` through epsilon
+  // transitions only, `state` included.
+  const uint32_t* epsilon_closure_begin(const State* state) const {
+    return epsilon_closures_.data() +
+        epsilon_closure_offsets_[state->index()];
+  }
+  const uint32_t* epsilon_closure_end(const State* state) const {
+    return epsilon_closures_.data() +
+        epsilon_closure_offsets_[state->index() + 1];
+  }
+  // True if `target` is in the epsilon closure of `state`.
+  bool InEpsilonClosure(const State* state, const State* target) const;
+  // True if the exit state is in the epsilon closure of `state`.
+  bool ReachesExitState(const State* state) const {
+    return InEpsilonClosure(state, exit_state_);
+  }
 
   int max_transition_match_length() const {
     return max_transition_match_length_;
@@ -78,10 +120,17 @@ class Automaton {
   State* exit_state_;
   State* last_state_;
 
-  vector<State*> states_;
+  ArenaVector<State*> states_;
+  ArenaVector<State*> exit_states_;
+  // The epsilon closures of all the states, computed once the automaton is
+  // built. The closure of state `i` is at [offsets[i], offsets[i + 1]).
+  ArenaVector<uint32_t> epsilon_closure_offsets_;
+  ArenaVector<uint32_t> epsilon_closures_;
 
   int max_transition_match_length_;
 
+  Arena* arena_;
+
   Status status_;
 
   friend class RegexpIndexer;
@@ -135,107 +184,6 @@ class RegexpIndexer {
 };
 
 
-class Simulation {
- public:
-  explicit Simulation(const Automaton* automaton)
-      : automaton_(automaton),
-        n_states_(automaton->NStates()),
-        n_ticks_(automaton->max_transition_match_length() + 1),
-        current_pos_(kInvalidPos),
-        data_(nullptr) {
-    data_ = reinterpret_cast<pos_t*>(malloc(ComputeDataSize()));
-    memset(data_, 0, ComputeDataSize());
-  }
-  ~Simulation() {
-    free(data_);
-  }
-
-  bool MatchFull(const char* text, size_t text_size);
-  bool MatchAnywhere(Match* match, const char* text, size_t text_size);
-  bool MatchFirst(Match* match, const char* text, size_t text_size);
-  bool MatchAll(vector<Match>* matches, const char* text, size_t text_size);
-
-  size_t ComputeTickSize() const {
-    return automaton_->NStates() * sizeof(pos_t);
-  }
-  size_t ComputeDataSize() const {
-    return n_ticks_ * ComputeTickSize();
-  }
-
-  pos_t* StatePointer(const State* state, int tick) const {
-    return StatePointer(state->index(), tick);
-  }
-
-  pos_t GetState(const State* state, int tick) const {
-    return *StatePointer(state, tick);
-  }
-
-  void SetState(pos_t pos, const State* state, int tick) const {
-    *StatePointer(state, tick) = pos;
-  }
-
-  void UpdateState(pos_t pos, const State* state, int tick) const {
-    STATIC_ASSERT(kInvalidPos == nullptr);
-    pos_t* state_pointer = StatePointer(state, tick);
-    *state_pointer = min(*state_pointer - 1, pos - 1) + 1;
-  }
-
-  void InvalidateState(const State* state, int tick) const {
-    STATIC_ASSERT(kInvalidPos == nullptr);
-    SetState(0, state, tick);
-  }
-
-  void InvalidateTick(int tick) const {
-    STATIC_ASSERT(kInvalidPos == nullptr);
-    memset(StatePointer(0, tick), 0, ComputeTickSize());
-  }
-
-  void Advance(int ticks) {
-    current_tick_ = (current_tick_ + ticks) % n_ticks_;
-    ASSERT(remaining_text_size() > 0);
-    ASSERT(current_pos_ < text_end_);
-    current_pos_++;
-  }
-
-  // Invalidate states set after start (excluded).
-  void InvalidateStatesAfter(pos_t start);
-
-  int Offset(pos_t pos) const { return pos - text_; }
-  int CurrentOffset() const { return Offset(current_pos_); }
-  void Print(int tick) const;
-  void Print() const {
-    for (int i = 0;
-         i < n_ticks_ && static_cast<size_t>(i) <= remaining_text_size();
-         i++) {
-      Print(i);
-    }
-    cout << "// End of offset\n";
-  }
-
-  size_t remaining_text_size() const { return text_end_ - current_pos_; }
-
-  Status status() const { return status_; }
-
- private:
-  pos_t* StatePointer(int state_index, int tick) const {
-    int t = (current_tick_ + tick) % n_ticks_;
-    return data_ + t * automaton_->NStates() + state_index;
-  }
-
-  const Automaton* automaton_;
-  const int n_states_;
-  const int n_ticks_;
-
-  int current_tick_;
-  pos_t text_;
-  pos_t text_end_;
-  pos_t current_pos_;
-
-  pos_t* data_;
-  Status status_;
-};
-
-
 } }  // namespace regit::internal
 
 #endif  // REGIT_AUTOMATON_H_
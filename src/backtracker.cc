@@ -0,0 +1,143 @@
+#include "backtracker.h"
+
+namespace regit {
+namespace internal {
+
+constexpr size_t Backtracker::kMaxPairs;
+
+
+void Backtracker::Reset(const char* text, size_t text_size) {
+  ASSERT(Fits(program_, text_size));
+  text_ = text;
+  text_size_ = text_size;
+  size_t n_pairs = n_states_ * (text_size + 1);
+  size_t n_words = (n_pairs + 63) / 64;
+  visited_ = scratch_->BacktrackerVisited(n_words);
+  ends_ = scratch_->BacktrackerEnds(n_pairs);
+  memset(visited_, 0, n_words * sizeof(uint64_t));
+}
+
+
+size_t Backtracker::Visit(uint32_t state, uint32_t offset) {
+  size_t pair = PairIndex(state, offset);
+  if (IsVisited(pair)) {
+    return pair;
+  }
+  SetVisited(pair);
+  uint32_t earliest = kNoEarliestEnd;
+  uint32_t latest = kNoLatestEnd;
+  if (static_cast<int>(state) == program_->exit_state()) {
+    earliest = offset;
+    latest = offset;
+  }
+  for (const Program::Transition* transition =
+           program_->transitions_begin(state);
+       transition < program_->transitions_end(state);
+       transition++) {
+    if ((offset + transition->length > text_size_) ||
+        (program_->Match(transition, text_ + offset,
+                         text_ + text_size_) == -1)) {
+      continue;
+    }
+    size_t next = Visit(transition->exit, offset + transition->length);
+    earliest = min(earliest, EarliestEnd(next));
+    latest = max(latest, LatestEnd(next));
+  }
+  SetEnds(pair, earliest, latest);
+  return pair;
+}
+
+
+bool Backtracker::FindFirst(Match* match, uint32_t from) {
+  // The earliest end of all matches, and the earliest start of the matches
+  // ending there. No match starting at or after `first_end` ends before it.
+  uint32_t first_end = kNoEarliestEnd;
+  uint32_t first_start = 0;
+  const uint32_t entry_state = program_->entry_state();
+  for (uint32_t start = from;
+       (start < text_size_) && (start < first_end);
+       start++) {
+    uint32_t end = EarliestEnd(Visit(entry_state, start));
+    if (end < first_end) {
+      first_end = end;
+      first_start = start;
+    }
+  }
+  if (first_end == kNoEarliestEnd) {
+    return false;
+  }
+  // Like `Simulation::MatchFirst()`: among the matches starting at or before
+  // `first_start`, prefer the one ending last, and then the one starting
+  // first. They all end at or after `first_end`, so they start within
+  // `max_match_length()` characters before it. All these starts have been
+  // visited above.
+  uint32_t begin = first_end - min(static_cast<uint32_t>(first_end - from),
+                                   static_cast<uint32_t>(
+                                       program_->max_match_length()));
+  uint32_t last_end = kNoLatestEnd;
+  uint32_t last_start = 0;
+  for (uint32_t start = begin; start <= first_start; start++) {
+    uint32_t end = LatestEnd(PairIndex(entry_state, start));
+    if (end > last_end) {
+      last_end = end;
+      last_start = start;
+    }
+  }
+  ASSERT(last_end >= first_end);
+  match->start = text_ + last_start;
+  match->end = text_ + last_end;
+  return true;
+}
+
+
+bool Backtracker::MatchFull(const char* text, size_t text_size) {
+  Reset(text, text_size);
+  // No match ends after the end of the text.
+  uint32_t end = LatestEnd(Visit(program_->entry_state(), 0));
+  return (end != kNoLatestEnd) && (end == text_size);
+}
+
+
+bool Backtracker::MatchAnywhere(Match* match,
+                                const char* text, size_t text_size) {
+  Reset(text, text_size);
+  uint32_t first_end = kNoEarliestEnd;
+  for (uint32_t start = 0;
+       (start < text_size) && (start < first_end);
+       start++) {
+    uint32_t end = EarliestEnd(Visit(program_->entry_state(), start));
+    if (end < first_end) {
+      first_end = end;
+      match->start = text + start;
+      match->end = text + end;
+    }
+  }
+  return first_end != kNoEarliestEnd;
+}
+
+
+bool Backtracker::MatchFirst(Match* match,
+                             const char* text, size_t text_size) {
+  Reset(text, text_size);
+  return FindFirst(match, 0);
+}
+
+
+bool Backtracker::MatchAll(vector<Match>* matches,
+                           const char* text, size_t text_size) {
+  // The ends memoized for each pair do not depend on where the search starts,
+  // so they are reused for all the matches.
+  Reset(text, text_size);
+  bool has_matched = false;
+  Match match;
+  uint32_t from = 0;
+  while ((from < text_size) && FindFirst(&match, from)) {
+    matches->push_back(match);
+    has_matched = true;
+    from = match.end - text;
+  }
+  return has_matched;
+}
+
+
+} }  // namespace regit::internal
@@ -0,0 +1,88 @@
+#ifndef REGIT_BACKTRACKER_H_
+#define REGIT_BACKTRACKER_H_
+
+#include "program.h"
+#include "regit.h"
+#include "scratch.h"
+
+namespace regit {
+namespace internal {
+
+// A bounded backtracker, for short texts.
+//
+// It explores the program depth-first from each start position, and records
+// the (state, offset) pairs visited in a bitmap. For each pair, it memoizes the
+// earliest and latest ends of the matches continuing from there, so that no
+// pair is explored twice and matching is linear in the number of pairs. The
+// matches found are the same as with the `Simulation`.
+//
+// Its setup only clears the bitmap, so it is cheaper than the simulation for
+// short texts. It can only be used when the number of pairs fits the budget
+// (see `Fits()`).
+class Backtracker {
+ public:
+  // The maximum number of (state, offset) pairs.
+  static constexpr size_t kMaxPairs = 32 * 1024;
+
+  static bool Fits(const Program* program, size_t text_size) {
+    return program->n_states() * (text_size + 1) <= kMaxPairs;
+  }
+
+  Backtracker(const Program* program, Scratch* scratch)
+      : program_(program),
+        n_states_(program->n_states()),
+        scratch_(scratch),
+        text_(nullptr), text_size_(0), visited_(nullptr), ends_(nullptr) {}
+
+  bool MatchFull(const char* text, size_t text_size);
+  bool MatchAnywhere(Match* match, const char* text, size_t text_size);
+  bool MatchFirst(Match* match, const char* text, size_t text_size);
+  bool MatchAll(vector<Match>* matches, const char* text, size_t text_size);
+
+ private:
+  // Ends are offsets in the text. Offsets fit in 16 bits within the budget.
+  static constexpr uint32_t kNoEarliestEnd = 0xffff;
+  static constexpr uint32_t kNoLatestEnd = 0;
+
+  // Prepare to match `text`, with no pair visited.
+  void Reset(const char* text, size_t text_size);
+
+  // Explore the pair, and the pairs reachable from it, if it was not visited.
+  // Offsets increase with each transition, so the recursion is not deeper
+  // than min(n_states, text_size + 1), which is at most sqrt(kMaxPairs).
+  // Returns the index of the pair.
+  size_t Visit(uint32_t state, uint32_t offset);
+  // Find the match preferred by `Simulation::MatchFirst()` among those
+  // starting at or after `from`.
+  bool FindFirst(Match* match, uint32_t from);
+
+  size_t PairIndex(uint32_t state, uint32_t offset) const {
+    return offset * n_states_ + state;
+  }
+  bool IsVisited(size_t pair) const {
+    return (visited_[pair / 64] >> (pair % 64)) & 1;
+  }
+  void SetVisited(size_t pair) {
+    visited_[pair / 64] |= uint64_t(1) << (pair % 64);
+  }
+  uint32_t EarliestEnd(size_t pair) const { return ends_[pair] & 0xffff; }
+  uint32_t LatestEnd(size_t pair) const { return ends_[pair] >> 16; }
+  void SetEnds(size_t pair, uint32_t earliest, uint32_t latest) {
+    ends_[pair] = earliest | (latest << 16);
+  }
+
+  const Program* program_;
+  const uint32_t n_states_;
+  Scratch* scratch_;
+
+  const char* text_;
+  uint32_t text_size_;
+  uint64_t* visited_;
+  // The earliest and latest ends of the matches from each visited pair.
+  uint32_t* ends_;
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_BACKTRACKER_H_
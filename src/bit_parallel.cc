@@ -0,0 +1,221 @@
+#include "bit_parallel.h"
+
+namespace regit {
+namespace internal {
+
+constexpr size_t BitParallel::kMaxPositions;
+
+
+size_t BitParallel::CountPositions(const Program* program) {
+  size_t n_positions = 0;
+  for (int state = 0; state < program->n_states(); state++) {
+    for (const Program::Transition* transition =
+             program->transitions_begin(state);
+         transition < program->transitions_end(state);
+         transition++) {
+      n_positions += transition->length;
+    }
+  }
+  return n_positions;
+}
+
+
+// Fill the tables giving, for each group of 8 positions, the union of
+// `targets[position]` for the positions of the group in `positions`.
+static void BuildGroupTables(vector<uint64_t>* tables,
+                             uint64_t positions,
+                             const uint64_t* targets,
+                             size_t n_positions) {
+  size_t n_groups = (n_positions + 7) / 8;
+  tables->assign(n_groups * 256, 0);
+  for (size_t group = 0; group < n_groups; group++) {
+    uint64_t* table = tables->data() + group * 256;
+    for (int bits = 1; bits < 256; bits++) {
+      // Derive the entry from the one without the lowest bit.
+      int lowest = __builtin_ctz(bits);
+      size_t position = group * 8 + lowest;
+      uint64_t targets_of_lowest = 0;
+      if ((position < n_positions) && ((positions >> position) & 1)) {
+        targets_of_lowest = targets[position];
+      }
+      table[bits] = table[bits & (bits - 1)] | targets_of_lowest;
+    }
+  }
+}
+
+
+BitParallel::BitParallel(const Program* program)
+    : match_starts_(0), match_ends_(0),
+      transition_starts_(0), transition_ends_(0),
+      max_match_length_(program->max_match_length()) {
+  size_t n_positions = CountPositions(program);
+  ASSERT(n_positions <= kMaxPositions);
+  memset(masks_, 0, sizeof(masks_));
+  // The first positions of the transitions leaving each state, and the last
+  // positions of the transitions entering each state.
+  vector<uint64_t> leaving(program->n_states(), 0);
+  vector<uint64_t> entering(program->n_states(), 0);
+  // The state a position's transition leaves from, or enters.
+  vector<int> source(n_positions);
+  vector<int> exit(n_positions);
+
+  size_t position = 0;
+  for (int state = 0; state < program->n_states(); state++) {
+    for (const Program::Transition* transition =
+             program->transitions_begin(state);
+         transition < program->transitions_end(state);
+         transition++) {
+      uint64_t first = uint64_t(1) << position;
+      uint64_t last = uint64_t(1) << (position + transition->length - 1);
+      leaving[state] |= first;
+      entering[transition->exit] |= last;
+      transition_starts_ |= first;
+      transition_ends_ |= last;
+      for (int i = 0; i < transition->length; i++, position++) {
+        source[position] = state;
+        exit[position] = transition->exit;
+        uint64_t bit = uint64_t(1) << position;
+        if (transition->kind == Program::kPeriodTransition) {
+          for (int c = 0; c < 256; c++) {
+            if (c != '\n' && c != '\r') {
+              masks_[c] |= bit;
+            }
+          }
+        } else {
+          masks_[static_cast<uint8_t>(program->literal(transition)[i])] |= bit;
+        }
+      }
+    }
+  }
+  match_starts_ = leaving[program->entry_state()];
+  match_ends_ = entering[program->exit_state()];
+
+  vector<uint64_t> following(n_positions);
+  vector<uint64_t> preceding(n_positions);
+  for (position = 0; position < n_positions; position++) {
+    following[position] = leaving[exit[position]];
+    preceding[position] = entering[source[position]];
+  }
+  BuildGroupTables(&follow_, transition_ends_, following.data(), n_positions);
+  BuildGroupTables(&precede_, transition_starts_, preceding.data(),
+                   n_positions);
+}
+
+
+pos_t BitParallel::FindEarliestEnd(const char* begin, const char* end) const {
+  uint64_t allowed = match_starts_;
+  for (const char* c = begin; c < end; c++) {
+    uint64_t active = allowed & masks_[static_cast<uint8_t>(*c)];
+    if (active & match_ends_) {
+      return c + 1;
+    }
+    allowed = Follow(active) | match_starts_;
+  }
+  return kInvalidPos;
+}
+
+
+pos_t BitParallel::FindEarliestStart(const char* text, pos_t end) const {
+  pos_t start = kInvalidPos;
+  uint64_t allowed = match_ends_;
+  // The loop ends at the latest after `max_match_length_` characters, when
+  // the positions starting a match have been reached.
+  for (const char* c = end - 1; (c >= text) && (allowed != 0); c--) {
+    uint64_t active = allowed & masks_[static_cast<uint8_t>(*c)];
+    if (active & match_starts_) {
+      start = c;
+    }
+    allowed = Precede(active);
+  }
+  return start;
+}
+
+
+pos_t BitParallel::FindLatestEnd(const char* begin, pos_t last_start,
+                                 const char* text_end) const {
+  pos_t end = kInvalidPos;
+  uint64_t allowed = 0;
+  for (const char* c = begin; c < text_end; c++) {
+    if (c <= last_start) {
+      allowed |= match_starts_;
+    } else if (allowed == 0) {
+      break;
+    }
+    uint64_t active = allowed & masks_[static_cast<uint8_t>(*c)];
+    if (active & match_ends_) {
+      end = c + 1;
+    }
+    allowed = Follow(active);
+  }
+  return end;
+}
+
+
+bool BitParallel::MatchFull(const char* text, size_t text_size) const {
+  uint64_t allowed = match_starts_;
+  uint64_t active = 0;
+  const char* text_end = text + text_size;
+  for (const char* c = text; c < text_end; c++) {
+    active = allowed & masks_[static_cast<uint8_t>(*c)];
+    if (active == 0) {
+      return false;
+    }
+    allowed = Follow(active);
+  }
+  return (active & match_ends_) != 0;
+}
+
+
+bool BitParallel::MatchAnywhere(Match* match,
+                                const char* text, size_t text_size) const {
+  pos_t end = FindEarliestEnd(text, text + text_size);
+  if (end == kInvalidPos) {
+    return false;
+  }
+  match->start = FindEarliestStart(text, end);
+  match->end = end;
+  ASSERT(match->start != kInvalidPos);
+  return true;
+}
+
+
+bool BitParallel::MatchFirst(Match* match,
+                             const char* text, size_t text_size) const {
+  // Like `Simulation::MatchFirst()`: among the matches starting at or before
+  // the start of the match ending first, prefer the one ending last, and then
+  // the one starting first.
+  const char* text_end = text + text_size;
+  pos_t first_end = FindEarliestEnd(text, text_end);
+  if (first_end == kInvalidPos) {
+    return false;
+  }
+  pos_t first_start = FindEarliestStart(text, first_end);
+  ASSERT(first_start != kInvalidPos);
+  // No match ends before `first_end`, so no match of interest starts more than
+  // `max_match_length_` characters before it.
+  const char* begin =
+      first_end - min(max_match_length_,
+                      static_cast<size_t>(first_end - text));
+  match->end = FindLatestEnd(begin, first_start, text_end);
+  ASSERT(match->end >= first_end);
+  match->start = FindEarliestStart(text, match->end);
+  ASSERT(match->start <= first_start);
+  return true;
+}
+
+
+bool BitParallel::MatchAll(vector<Match>* matches,
+                           const char* text, size_t text_size) const {
+  bool has_matched = false;
+  Match match;
+  const char* text_end = text + text_size;
+  while ((text < text_end) && MatchFirst(&match, text, text_end - text)) {
+    matches->push_back(match);
+    has_matched = true;
+    text = match.end;
+  }
+  return has_matched;
+}
+
+
+} }  // namespace regit::internal
@@ -0,0 +1,103 @@
+#ifndef REGIT_BIT_PARALLEL_H_
+#define REGIT_BIT_PARALLEL_H_
+
+#include <vector>
+
+#include "globals.h"
+#include "program.h"
+#include "regit.h"
+
+namespace regit {
+namespace internal {
+
+// A bit-parallel engine for programs with at most 64 positions, in the style of
+// Shift-And over the Glushkov automaton of the program.
+//
+// Each character matched by a transition is a position: a literal of n
+// characters has n consecutive positions, and a period has one. The set of
+// positions that have just matched the text is kept in a single `uint64_t`.
+// Moving to the next character costs a shift for the positions followed by
+// the next one of the same literal, a few table lookups for the positions
+// ending a transition, and a mask of the positions matching the character.
+//
+// Starts of matches are found by running the same automaton backward from the
+// end of a match. As matches are at most 64 characters long, finding a match
+// costs a scan to its end, plus a constant amount of work.
+class BitParallel {
+ public:
+  static constexpr size_t kMaxPositions = 64;
+
+  static size_t CountPositions(const Program* program);
+
+  // The program must have at most `kMaxPositions` positions.
+  explicit BitParallel(const Program* program);
+
+  bool MatchFull(const char* text, size_t text_size) const;
+  bool MatchAnywhere(Match* match, const char* text, size_t text_size) const;
+  bool MatchFirst(Match* match, const char* text, size_t text_size) const;
+  bool MatchAll(vector<Match>* matches,
+                const char* text, size_t text_size) const;
+
+  // The memory used by the tables, in bytes.
+  size_t size() const {
+    return sizeof(*this) +
+        (follow_.size() + precede_.size()) * sizeof(uint64_t);
+  }
+
+ private:
+  // The positions that can match the character after the positions in
+  // `positions`.
+  uint64_t Follow(uint64_t positions) const {
+    uint64_t next = (positions & ~transition_ends_) << 1;
+    const uint64_t* table = follow_.data();
+    for (uint64_t ends = positions & transition_ends_;
+         ends != 0;
+         ends >>= 8, table += 256) {
+      next |= table[ends & 0xff];
+    }
+    return next;
+  }
+  // The positions that can match the character before the positions in
+  // `positions`.
+  uint64_t Precede(uint64_t positions) const {
+    uint64_t previous = (positions & ~transition_starts_) >> 1;
+    const uint64_t* table = precede_.data();
+    for (uint64_t starts = positions & transition_starts_;
+         starts != 0;
+         starts >>= 8, table += 256) {
+      previous |= table[starts & 0xff];
+    }
+    return previous;
+  }
+
+  // The earliest end of a match in [`begin`, `end`), or `kInvalidPos`.
+  pos_t FindEarliestEnd(const char* begin, const char* end) const;
+  // The earliest start, not before `text`, of a match ending at `end`, or
+  // `kInvalidPos`.
+  pos_t FindEarliestStart(const char* text, pos_t end) const;
+  // The latest end, not after `text_end`, of a match starting in
+  // [`begin`, `last_start`], or `kInvalidPos`.
+  pos_t FindLatestEnd(const char* begin, pos_t last_start,
+                      const char* text_end) const;
+
+  // The positions matching each character.
+  uint64_t masks_[256];
+  // The positions starting a match, and the positions ending one.
+  uint64_t match_starts_;
+  uint64_t match_ends_;
+  // The first and last positions of each transition.
+  uint64_t transition_starts_;
+  uint64_t transition_ends_;
+  // For each group of 8 positions, the positions following (or preceding) each
+  // combination of transition ends (or starts) in the group.
+  vector<uint64_t> follow_;
+  vector<uint64_t> precede_;
+  size_t max_match_length_;
+
+  DISALLOW_COPY_AND_ASSIGN(BitParallel);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_BIT_PARALLEL_H_
@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include "byte_nfa.h"
+
+namespace regit {
+namespace internal {
+
+ByteNFA::ByteNFA(const Program* program, bool reversed) {
+  // Intermediate nodes for literals are numbered after the program states.
+  vector<vector<Edge>> edges(program->n_states());
+  for (int state = 0; state < program->n_states(); state++) {
+    for (const Program::Transition* transition =
+             program->transitions_begin(state);
+         transition < program->transitions_end(state);
+         transition++) {
+      if (transition->kind == Program::kPeriodTransition) {
+        edges[state].push_back({true, 0, transition->exit});
+        continue;
+      }
+      const char* literal = program->literal(transition);
+      uint32_t from = state;
+      for (int i = 0; i < transition->length; i++) {
+        uint32_t next;
+        if (i == transition->length - 1) {
+          next = transition->exit;
+        } else {
+          next = edges.size();
+          edges.push_back(vector<Edge>());
+        }
+        edges[from].push_back({false, literal[i], next});
+        from = next;
+      }
+    }
+  }
+  entry_node_ = program->entry_state();
+  exit_node_ = program->exit_state();
+  if (reversed) {
+    vector<vector<Edge>> reversed_edges(edges.size());
+    for (uint32_t node = 0; node < edges.size(); node++) {
+      for (const Edge& edge : edges[node]) {
+        reversed_edges[edge.next].push_back({edge.period, edge.c, node});
+      }
+    }
+    edges.swap(reversed_edges);
+    std::swap(entry_node_, exit_node_);
+  }
+  nodes_.reserve(edges.size() + 1);
+  for (const vector<Edge>& node_edges : edges) {
+    nodes_.push_back(edges_.size());
+    edges_.insert(edges_.end(), node_edges.begin(), node_edges.end());
+  }
+  nodes_.push_back(edges_.size());
+  node_added_.resize(edges.size(), false);
+}
+
+
+void ByteNFA::Step(vector<uint32_t>* next,
+                   const uint32_t* begin, const uint32_t* end,
+                   char c, bool reseed) const {
+  next->clear();
+  for (const uint32_t* node = begin; node < end; node++) {
+    for (const Edge* edge = edges_begin(*node);
+         edge < edges_end(*node);
+         edge++) {
+      if (edge->Matches(c) && !node_added_[edge->next]) {
+        node_added_[edge->next] = true;
+        next->push_back(edge->next);
+      }
+    }
+  }
+  if (reseed && !node_added_[entry_node_]) {
+    node_added_[entry_node_] = true;
+    next->push_back(entry_node_);
+  }
+  for (uint32_t node : *next) {
+    node_added_[node] = false;
+  }
+  std::sort(next->begin(), next->end());
+}
+
+
+} }  // namespace regit::internal
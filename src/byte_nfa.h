@@ -0,0 +1,75 @@
+#ifndef REGIT_BYTE_NFA_H_
+#define REGIT_BYTE_NFA_H_
+
+#include <vector>
+
+#include "globals.h"
+#include "program.h"
+
+namespace regit {
+namespace internal {
+
+// A byte-level view of a program, where each transition matches exactly one
+// character: a literal of n characters becomes a chain of n transitions through
+// n - 1 intermediate nodes. The first nodes are the states of the program.
+// This is the NFA from which the DFA engines build their states.
+//
+// The NFA can also be reversed, to match texts backward: its edges then go the
+// other way, and its entry and exit nodes are swapped. Running it back from
+// the end of a match finds where the match starts.
+class ByteNFA {
+ public:
+  struct Edge {
+    // Periods match any character but '\n' and '\r'.
+    bool period;
+    char c;
+    uint32_t next;
+
+    bool Matches(char character) const {
+      return period ? (character != '\n' && character != '\r')
+                    : (character == c);
+    }
+  };
+
+  explicit ByteNFA(const Program* program, bool reversed = false);
+
+  size_t n_nodes() const { return nodes_.size() - 1; }
+  uint32_t entry_node() const { return entry_node_; }
+  uint32_t exit_node() const { return exit_node_; }
+
+  // The memory used, in bytes.
+  size_t size() const {
+    return sizeof(*this) + nodes_.size() * sizeof(uint32_t) +
+        edges_.size() * sizeof(Edge) + node_added_.size() / 8;
+  }
+
+  const Edge* edges_begin(uint32_t node) const {
+    return edges_.data() + nodes_[node];
+  }
+  const Edge* edges_end(uint32_t node) const {
+    return edges_.data() + nodes_[node + 1];
+  }
+
+  // Compute in `next` the sorted set of nodes reached from the sorted set of
+  // nodes [`begin`, `end`) when matching `c`. When `reseed` is true, the entry
+  // node is added, so that a new match can start at every position.
+  void Step(vector<uint32_t>* next,
+            const uint32_t* begin, const uint32_t* end,
+            char c, bool reseed) const;
+
+ private:
+  vector<uint32_t> nodes_;
+  vector<Edge> edges_;
+  uint32_t entry_node_;
+  uint32_t exit_node_;
+
+  // Used by `Step()` to avoid duplicates.
+  mutable vector<bool> node_added_;
+
+  DISALLOW_COPY_AND_ASSIGN(ByteNFA);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_BYTE_NFA_H_
@@ -0,0 +1,75 @@
+#ifndef REGIT_BYTES_H_
+#define REGIT_BYTES_H_
+
+#include <stddef.h>
+#include <string.h>
+
+#include "globals.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace regit {
+namespace internal {
+
+// Load a `T` from an unaligned address.
+template <typename T>
+inline T LoadUnaligned(const char* p) {
+  T value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+
+// True if the `size` bytes at `a` and `b` are equal. Unlike `strncmp()`, it
+// does not stop at NUL bytes, and unlike `memcmp()` it is inlined for the short
+// literals the parser produces.
+//
+// No byte outside of the ranges is read: the first and last words of the
+// ranges are compared with two loads, which overlap when the size is not a
+// multiple of the word size. Sizes of 16 bytes or more are compared with SSE2
+// when available.
+inline bool EqualBytes(const char* a, const char* b, size_t size) {
+  if (size >= 16) {
+#ifdef __SSE2__
+    for (size_t offset = 0; ; offset += 16) {
+      if (offset + 16 > size) {
+        offset = size - 16;
+      }
+      __m128i equal = _mm_cmpeq_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + offset)),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + offset)));
+      if (_mm_movemask_epi8(equal) != 0xffff) {
+        return false;
+      }
+      if (offset + 16 == size) {
+        return true;
+      }
+    }
+#else
+    return !memcmp(a, b, size);
+#endif
+  }
+  if (size >= 8) {
+    return (LoadUnaligned<uint64_t>(a) == LoadUnaligned<uint64_t>(b)) &&
+        (LoadUnaligned<uint64_t>(a + size - 8) ==
+         LoadUnaligned<uint64_t>(b + size - 8));
+  }
+  if (size >= 4) {
+    return (LoadUnaligned<uint32_t>(a) == LoadUnaligned<uint32_t>(b)) &&
+        (LoadUnaligned<uint32_t>(a + size - 4) ==
+         LoadUnaligned<uint32_t>(b + size - 4));
+  }
+  if (size >= 2) {
+    return (LoadUnaligned<uint16_t>(a) == LoadUnaligned<uint16_t>(b)) &&
+        (LoadUnaligned<uint16_t>(a + size - 2) ==
+         LoadUnaligned<uint16_t>(b + size - 2));
+  }
+  return (size == 0) || (*a == *b);
+}
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_BYTES_H_
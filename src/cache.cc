@@ -0,0 +1,115 @@
+#include "cache.h"
+
+namespace regit {
+
+void EnableCompilationCache(size_t byte_budget) {
+  internal::RegexpCache::Get()->SetBudget(byte_budget);
+}
+
+
+void DisableCompilationCache() {
+  internal::RegexpCache::Get()->SetBudget(0);
+}
+
+
+CacheCounters GetCompilationCacheCounters() {
+  return internal::RegexpCache::Get()->counters();
+}
+
+
+namespace internal {
+
+RegexpCache* RegexpCache::Get() {
+  static RegexpCache cache;
+  return &cache;
+}
+
+
+string RegexpCache::Key(const string& regexp, const Options& options) {
+  // Options are encoded before the regexp, so that keys cannot be ambiguous.
+  string key;
+  key += options.posix_period_ ? '1' : '0';
+  key.append(reinterpret_cast<const char*>(&options.max_dfa_states_),
+             sizeof(options.max_dfa_states_));
+  key += options.jit_ ? '1' : '0';
+  // So do the flags read during compilation. The other flags are only read
+  // when matching.
+  key += FLAG_parser_opt ? '1' : '0';
+  key += regexp;
+  return key;
+}
+
+
+shared_ptr<const RegexpInfo> RegexpCache::Lookup(const string& key) {
+  Shard* shard = ShardFor(key);
+  std::lock_guard<std::mutex> lock(shard->mutex_);
+  auto it = shard->index_.find(key);
+  if (it == shard->index_.end()) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  shard->lru_.splice(shard->lru_.begin(), shard->lru_, it->second);
+  return it->second->second;
+}
+
+
+shared_ptr<const RegexpInfo> RegexpCache::Insert(
+    const string& key, shared_ptr<const RegexpInfo> rinfo) {
+  Shard* shard = ShardFor(key);
+  std::lock_guard<std::mutex> lock(shard->mutex_);
+  size_t budget = shard_budget();
+  if (rinfo->size() > budget) {
+    // This also covers the cache being disabled.
+    return rinfo;
+  }
+  auto it = shard->index_.find(key);
+  if (it != shard->index_.end()) {
+    return it->second->second;
+  }
+  shard->lru_.push_front(Shard::Entry(key, rinfo));
+  shard->index_[key] = shard->lru_.begin();
+  shard->size_ += rinfo->size();
+  EvictFrom(shard, budget);
+  return rinfo;
+}
+
+
+void RegexpCache::EvictFrom(Shard* shard, size_t budget) {
+  while (shard->size_ > budget) {
+    ASSERT(!shard->lru_.empty());
+    const Shard::Entry& entry = shard->lru_.back();
+    shard->size_ -= entry.second->size();
+    shard->index_.erase(entry.first);
+    shard->lru_.pop_back();
+    evictions_++;
+  }
+}
+
+
+void RegexpCache::SetBudget(size_t budget) {
+  budget_ = budget;
+  for (Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    EvictFrom(&shard, shard_budget());
+  }
+}
+
+
+CacheCounters RegexpCache::counters() {
+  CacheCounters counters;
+  counters.hits = hits_;
+  counters.misses = misses_;
+  counters.evictions = evictions_;
+  counters.n_entries = 0;
+  counters.size = 0;
+  for (Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    counters.n_entries += shard.index_.size();
+    counters.size += shard.size_;
+  }
+  return counters;
+}
+
+
+} }  // namespace regit::internal
@@ -0,0 +1,80 @@
+#ifndef REGIT_CACHE_H_
+#define REGIT_CACHE_H_
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "globals.h"
+#include "regexp_info.h"
+#include "regit.h"
+
+namespace regit {
+namespace internal {
+
+// Process-wide cache of compiled regexps.
+// Entries are split across shards, each protected by its own lock, so that
+// lookups from different threads rarely contend. Each shard keeps its entries
+// in LRU order and evicts from the tail when it exceeds its share of the byte
+// budget. Entries are reference counted: evicting an entry does not affect the
+// `Regit` objects still using it.
+class RegexpCache {
+ public:
+  static RegexpCache* Get();
+
+  static string Key(const string& regexp, const Options& options);
+
+  // Return the cached compiled regexp for `key`, or nullptr.
+  shared_ptr<const RegexpInfo> Lookup(const string& key);
+  // Insert `rinfo` for `key`. If another thread inserted an entry for the same
+  // key first, that entry is returned and should be used instead.
+  shared_ptr<const RegexpInfo> Insert(const string& key,
+                                      shared_ptr<const RegexpInfo> rinfo);
+
+  bool enabled() const { return budget_ != 0; }
+  // A budget of 0 disables the cache and drops all entries.
+  void SetBudget(size_t budget);
+
+  CacheCounters counters();
+
+ private:
+  RegexpCache() : budget_(0), hits_(0), misses_(0), evictions_(0) {}
+
+  class Shard {
+   public:
+    Shard() : size_(0) {}
+
+    typedef pair<string, shared_ptr<const RegexpInfo>> Entry;
+
+    std::mutex mutex_;
+    // Most recently used entries first.
+    std::list<Entry> lru_;
+    std::unordered_map<string, std::list<Entry>::iterator> index_;
+    size_t size_;
+  };
+
+  static constexpr size_t kNShards = 16;
+
+  Shard* ShardFor(const string& key) {
+    return &shards_[std::hash<string>()(key) % kNShards];
+  }
+  size_t shard_budget() const { return budget_ / kNShards; }
+  // Must be called with the shard locked.
+  void EvictFrom(Shard* shard, size_t budget);
+
+  Shard shards_[kNShards];
+  std::atomic<size_t> budget_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  std::atomic<uint64_t> evictions_;
+
+  DISALLOW_COPY_AND_ASSIGN(RegexpCache);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_CACHE_H_
@@ -0,0 +1,481 @@
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+#include "byte_nfa.h"
+#include "dfa.h"
+#include "program.h"
+
+namespace regit {
+namespace internal {
+
+constexpr uint32_t DFA::kMaxStates;
+constexpr uint32_t DFA::kNoState;
+
+
+// The DFA built by subset construction, before minimization.
+class SubsetDFA {
+ public:
+  // The byte classes are those of the program of `nfa`.
+  SubsetDFA(const ByteNFA* nfa, const Program* program, uint32_t max_states);
+
+  // Returns false if more than `max_states_` states are needed.
+  bool Build();
+
+  uint32_t n_states() const { return accepting_.size(); }
+  uint32_t n_classes() const { return n_classes_; }
+  const uint8_t* byte_classes() const { return byte_classes_; }
+  uint32_t next(uint32_t state, uint32_t byte_class) const {
+    return transitions_[state * n_classes_ + byte_class];
+  }
+  bool accepting(uint32_t state) const { return accepting_[state]; }
+  uint32_t full_start() const { return full_start_; }
+  uint32_t anywhere_start() const { return anywhere_start_; }
+  uint32_t dead_state() const { return dead_state_; }
+
+ private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  // Returns `kNone` if the state cannot be added.
+  uint32_t AddState(const vector<uint32_t>& nodes, bool reseed);
+
+  const ByteNFA* nfa_;
+  const uint32_t max_states_;
+
+  uint8_t byte_classes_[256];
+  uint32_t n_classes_;
+  // A byte of each class.
+  vector<char> representatives_;
+
+  // The nodes of each state, and whether it reseeds.
+  vector<vector<uint32_t>> nodes_;
+  vector<bool> reseed_;
+  vector<bool> accepting_;
+  vector<uint32_t> transitions_;
+  unordered_map<string, uint32_t> index_;
+  uint32_t full_start_;
+  uint32_t anywhere_start_;
+  // The single accepting state of the anywhere mode.
+  uint32_t anywhere_accept_;
+  uint32_t dead_state_;
+};
+
+constexpr uint32_t SubsetDFA::kNone;
+
+
+SubsetDFA::SubsetDFA(const ByteNFA* nfa, const Program* program,
+                     uint32_t max_states)
+    : nfa_(nfa), max_states_(max_states),
+      n_classes_(program->n_byte_classes()),
+      representatives_(n_classes_),
+      full_start_(kNone), anywhere_start_(kNone), anywhere_accept_(kNone),
+      dead_state_(kNone) {
+  memcpy(byte_classes_, program->byte_classes(), sizeof(byte_classes_));
+  for (int byte = 255; byte >= 0; byte--) {
+    representatives_[byte_classes_[byte]] = static_cast<char>(byte);
+  }
+}
+
+
+uint32_t SubsetDFA::AddState(const vector<uint32_t>& nodes, bool reseed) {
+  bool accepting =
+      std::binary_search(nodes.begin(), nodes.end(), nfa_->exit_node());
+  if (accepting && reseed && (anywhere_accept_ != kNone)) {
+    return anywhere_accept_;
+  }
+  string key(sizeof(uint32_t), reseed ? 1 : 0);
+  if (!(accepting && reseed)) {
+    key.append(reinterpret_cast<const char*>(nodes.data()),
+               nodes.size() * sizeof(uint32_t));
+    unordered_map<string, uint32_t>::iterator it = index_.find(key);
+    if (it != index_.end()) {
+      return it->second;
+    }
+  }
+  if (n_states() >= max_states_) {
+    return kNone;
+  }
+  uint32_t state = n_states();
+  if (accepting && reseed) {
+    anywhere_accept_ = state;
+  } else {
+    index_.insert(make_pair(key, state));
+  }
+  nodes_.push_back(nodes);
+  reseed_.push_back(reseed);
+  accepting_.push_back(accepting);
+  transitions_.resize(transitions_.size() + n_classes_, kNone);
+  if (!reseed && nodes.empty()) {
+    dead_state_ = state;
+  }
+  return state;
+}
+
+
+bool SubsetDFA::Build() {
+  vector<uint32_t> nodes(1, nfa_->entry_node());
+  full_start_ = AddState(nodes, false);
+  anywhere_start_ = AddState(nodes, true);
+  if (anywhere_start_ == kNone) {
+    return false;
+  }
+  // States are processed in the order they are added.
+  for (uint32_t state = 0; state < n_states(); state++) {
+    for (uint32_t byte_class = 0; byte_class < n_classes_; byte_class++) {
+      uint32_t next;
+      if (state == anywhere_accept_) {
+        next = state;
+      } else {
+        const vector<uint32_t>& state_nodes = nodes_[state];
+        nfa_->Step(&nodes, state_nodes.data(),
+                   state_nodes.data() + state_nodes.size(),
+                   representatives_[byte_class], reseed_[state]);
+        next = AddState(nodes, reseed_[state]);
+        if (next == kNone) {
+          return false;
+        }
+      }
+      transitions_[state * n_classes_ + byte_class] = next;
+    }
+  }
+  return true;
+}
+
+
+// Hopcroft's minimization, refining the partition of the states into
+// accepting and non-accepting states until all states in a block have
+// transitions to the same blocks.
+class Minimizer {
+ public:
+  explicit Minimizer(const SubsetDFA* dfa);
+
+  void Minimize();
+
+  uint32_t n_blocks() const { return block_begin_.size(); }
+  uint32_t block_of(uint32_t state) const { return block_of_[state]; }
+  // A state of the block.
+  uint32_t representative(uint32_t block) const {
+    return elements_[block_begin_[block]];
+  }
+
+ private:
+  uint32_t AddBlock(uint32_t begin, uint32_t end);
+  void AddSplitter(uint32_t block, uint32_t byte_class);
+  void Mark(uint32_t state);
+  void Split(uint32_t block);
+
+  const uint32_t n_states_;
+  const uint32_t n_classes_;
+
+  // The states that reach `state` on `byte_class` are
+  // `predecessors_[predecessors_begin_[byte_class * n_states_ + state]]`, up
+  // to the next entry.
+  vector<uint32_t> predecessors_begin_;
+  vector<uint32_t> predecessors_;
+
+  // The states, grouped by block. The marked states of a block come first.
+  vector<uint32_t> elements_;
+  vector<uint32_t> location_;
+  vector<uint32_t> block_of_;
+  vector<uint32_t> block_begin_;
+  vector<uint32_t> block_end_;
+  vector<uint32_t> block_marked_;
+  vector<uint32_t> touched_blocks_;
+
+  // Pairs of block and class, encoded as `block * n_classes_ + byte_class`.
+  vector<uint32_t> splitters_;
+  vector<bool> is_splitter_;
+};
+
+
+Minimizer::Minimizer(const SubsetDFA* dfa)
+    : n_states_(dfa->n_states()), n_classes_(dfa->n_classes()) {
+  predecessors_begin_.resize(n_classes_ * n_states_ + 1, 0);
+  for (uint32_t state = 0; state < n_states_; state++) {
+    for (uint32_t byte_class = 0; byte_class < n_classes_; byte_class++) {
+      predecessors_begin_[byte_class * n_states_ +
+                          dfa->next(state, byte_class) + 1]++;
+    }
+  }
+  for (size_t i = 1; i < predecessors_begin_.size(); i++) {
+    predecessors_begin_[i] += predecessors_begin_[i - 1];
+  }
+  predecessors_.resize(n_states_ * n_classes_);
+  vector<uint32_t> fill(predecessors_begin_.begin(),
+                        predecessors_begin_.end() - 1);
+  for (uint32_t state = 0; state < n_states_; state++) {
+    for (uint32_t byte_class = 0; byte_class < n_classes_; byte_class++) {
+      uint32_t next = dfa->next(state, byte_class);
+      predecessors_[fill[byte_class * n_states_ + next]++] = state;
+    }
+  }
+
+  location_.resize(n_states_);
+  block_of_.resize(n_states_);
+  for (uint32_t state = 0; state < n_states_; state++) {
+    if (dfa->accepting(state)) {
+      elements_.push_back(state);
+    }
+  }
+  uint32_t n_accepting = elements_.size();
+  for (uint32_t state = 0; state < n_states_; state++) {
+    if (!dfa->accepting(state)) {
+      elements_.push_back(state);
+    }
+  }
+  for (uint32_t i = 0; i < n_states_; i++) {
+    location_[elements_[i]] = i;
+  }
+  if (n_accepting > 0) {
+    AddBlock(0, n_accepting);
+  }
+  if (n_accepting < n_states_) {
+    AddBlock(n_accepting, n_states_);
+  }
+}
+
+
+uint32_t Minimizer::AddBlock(uint32_t begin, uint32_t end) {
+  uint32_t block = block_begin_.size();
+  block_begin_.push_back(begin);
+  block_end_.push_back(end);
+  block_marked_.push_back(0);
+  for (uint32_t i = begin; i < end; i++) {
+    block_of_[elements_[i]] = block;
+  }
+  is_splitter_.resize(is_splitter_.size() + n_classes_, false);
+  return block;
+}
+
+
+void Minimizer::AddSplitter(uint32_t block, uint32_t byte_class) {
+  uint32_t splitter = block * n_classes_ + byte_class;
+  if (!is_splitter_[splitter]) {
+    is_splitter_[splitter] = true;
+    splitters_.push_back(splitter);
+  }
+}
+
+
+void Minimizer::Mark(uint32_t state) {
+  uint32_t block = block_of_[state];
+  uint32_t marked_end = block_begin_[block] + block_marked_[block];
+  if (location_[state] < marked_end) {
+    return;
+  }
+  // Swap the state with the first unmarked state of its block.
+  uint32_t other = elements_[marked_end];
+  elements_[location_[state]] = other;
+  location_[other] = location_[state];
+  elements_[marked_end] = state;
+  location_[state] = marked_end;
+  if (block_marked_[block]++ == 0) {
+    touched_blocks_.push_back(block);
+  }
+}
+
+
+void Minimizer::Split(uint32_t block) {
+  uint32_t marked_end = block_begin_[block] + block_marked_[block];
+  block_marked_[block] = 0;
+  if (marked_end == block_end_[block]) {
+    return;
+  }
+  // The marked states move to a new block.
+  uint32_t new_block = AddBlock(block_begin_[block], marked_end);
+  block_begin_[block] = marked_end;
+  uint32_t block_size = block_end_[block] - block_begin_[block];
+  uint32_t new_block_size = block_end_[new_block] - block_begin_[new_block];
+  for (uint32_t byte_class = 0; byte_class < n_classes_; byte_class++) {
+    if (is_splitter_[block * n_classes_ + byte_class]) {
+      AddSplitter(new_block, byte_class);
+    } else {
+      AddSplitter(new_block_size <= block_size ? new_block : block,
+                  byte_class);
+    }
+  }
+}
+
+
+void Minimizer::Minimize() {
+  if (n_blocks() == 2) {
+    uint32_t smaller =
+        (block_end_[0] - block_begin_[0] <= block_end_[1] - block_begin_[1]) ?
+        0 : 1;
+    for (uint32_t byte_class = 0; byte_class < n_classes_; byte_class++) {
+      AddSplitter(smaller, byte_class);
+    }
+  }
+  vector<uint32_t> splitter_states;
+  while (!splitters_.empty()) {
+    uint32_t splitter = splitters_.back();
+    splitters_.pop_back();
+    is_splitter_[splitter] = false;
+    uint32_t block = splitter / n_classes_;
+    uint32_t byte_class = splitter % n_classes_;
+    // Marking reorders the states of the blocks, including this one.
+    splitter_states.assign(elements_.begin() + block_begin_[block],
+                           elements_.begin() + block_end_[block]);
+    for (uint32_t state : splitter_states) {
+      uint32_t index = byte_class * n_states_ + state;
+      for (uint32_t i = predecessors_begin_[index];
+           i < predecessors_begin_[index + 1];
+           i++) {
+        Mark(predecessors_[i]);
+      }
+    }
+    for (uint32_t touched : touched_blocks_) {
+      Split(touched);
+    }
+    touched_blocks_.clear();
+  }
+}
+
+
+bool DFA::Build(vector<char>* section,
+                const Program* program,
+                uint32_t max_states) {
+  ByteNFA nfa(program);
+  SubsetDFA subset_dfa(&nfa, program, min(max_states, kMaxStates));
+  if (!subset_dfa.Build()) {
+    return false;
+  }
+  Minimizer minimizer(&subset_dfa);
+  minimizer.Minimize();
+
+  // Number the accepting blocks first.
+  uint32_t n_states = minimizer.n_blocks();
+  uint32_t n_classes = subset_dfa.n_classes();
+  vector<uint32_t> state_of_block(n_states);
+  uint32_t n_accepting = 0;
+  for (uint32_t block = 0; block < n_states; block++) {
+    if (subset_dfa.accepting(minimizer.representative(block))) {
+      state_of_block[block] = n_accepting++;
+    }
+  }
+  uint32_t n_numbered = n_accepting;
+  for (uint32_t block = 0; block < n_states; block++) {
+    if (!subset_dfa.accepting(minimizer.representative(block))) {
+      state_of_block[block] = n_numbered++;
+    }
+  }
+
+  Header header;
+  header.n_states = n_states;
+  header.n_classes = n_classes;
+  header.n_accepting = n_accepting;
+  // Convert the states of the subset DFA to rows offsets.
+  auto row = [&](uint32_t subset_state) {
+    return state_of_block[minimizer.block_of(subset_state)] * n_classes;
+  };
+  header.full_start = row(subset_dfa.full_start());
+  header.anywhere_start = row(subset_dfa.anywhere_start());
+  header.dead_state = kNoState;
+  if (subset_dfa.dead_state() < subset_dfa.n_states()) {
+    header.dead_state = row(subset_dfa.dead_state());
+  }
+  vector<uint32_t> transitions(n_states * n_classes);
+  for (uint32_t block = 0; block < n_states; block++) {
+    uint32_t representative = minimizer.representative(block);
+    for (uint32_t byte_class = 0; byte_class < n_classes; byte_class++) {
+      transitions[state_of_block[block] * n_classes + byte_class] =
+          row(subset_dfa.next(representative, byte_class));
+    }
+  }
+
+  section->resize(SectionSize(n_states, n_classes));
+  char* data = section->data();
+  memcpy(data, &header, sizeof(header));
+  memcpy(data + sizeof(header), subset_dfa.byte_classes(), 256);
+  memcpy(data + sizeof(header) + 256, transitions.data(),
+         transitions.size() * sizeof(uint32_t));
+  return true;
+}
+
+
+bool DFA::IsValidSection(const char* section, size_t size) {
+  if (size < sizeof(Header) + 256) {
+    return false;
+  }
+  const Header* header = reinterpret_cast<const Header*>(section);
+  if ((header->n_states == 0) || (header->n_states > kMaxStates) ||
+      (header->n_classes == 0) || (header->n_classes > 256) ||
+      (size != SectionSize(header->n_states, header->n_classes)) ||
+      (header->n_accepting > header->n_states)) {
+    return false;
+  }
+  const uint32_t n_classes = header->n_classes;
+  const uint32_t n_rows = header->n_states * n_classes;
+  auto is_valid_row = [=](uint32_t row) {
+    return (row < n_rows) && (row % n_classes == 0);
+  };
+  if (!is_valid_row(header->full_start) ||
+      !is_valid_row(header->anywhere_start) ||
+      ((header->dead_state != kNoState) &&
+       !is_valid_row(header->dead_state))) {
+    return false;
+  }
+  DFA dfa;
+  dfa.SetSection(section);
+  for (int byte = 0; byte < 256; byte++) {
+    if (dfa.byte_classes_[byte] >= n_classes) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < n_rows; i++) {
+    if (!is_valid_row(dfa.transitions_[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+void DFA::SetSection(const char* section) {
+  header_ = reinterpret_cast<const Header*>(section);
+  byte_classes_ = reinterpret_cast<const uint8_t*>(section + sizeof(Header));
+  transitions_ = reinterpret_cast<const uint32_t*>(
+      section + sizeof(Header) + 256);
+}
+
+
+bool DFA::MatchFull(const char* text, size_t text_size) const {
+  // Keep the tables in locals: stores through `char` pointers could alias
+  // them otherwise.
+  const uint8_t* byte_classes = byte_classes_;
+  const uint32_t* transitions = transitions_;
+  const uint32_t dead_state = header_->dead_state;
+  uint32_t state = header_->full_start;
+  const char* text_end = text + text_size;
+  for (const char* c = text; c < text_end; c++) {
+    state = transitions[state + byte_classes[static_cast<uint8_t>(*c)]];
+    if (state == dead_state) {
+      return false;
+    }
+  }
+  return state < header_->n_accepting * header_->n_classes;
+}
+
+
+bool DFA::MatchAnywhereEnd(pos_t* end,
+                           const char* text, size_t text_size) const {
+  const uint8_t* byte_classes = byte_classes_;
+  const uint32_t* transitions = transitions_;
+  const uint32_t accepting_rows_end =
+      header_->n_accepting * header_->n_classes;
+  uint32_t state = header_->anywhere_start;
+  const char* text_end = text + text_size;
+  for (const char* c = text; c < text_end; c++) {
+    state = transitions[state + byte_classes[static_cast<uint8_t>(*c)]];
+    if (state < accepting_rows_end) {
+      *end = c + 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+} }  // namespace regit::internal
@@ -0,0 +1,98 @@
+#ifndef REGIT_DFA_H_
+#define REGIT_DFA_H_
+
+#include <vector>
+
+#include "globals.h"
+#include "regit.h"
+
+namespace regit {
+namespace internal {
+
+class Program;
+
+// A complete DFA built at compilation time, by subset construction over the
+// program's `ByteNFA`, and minimized with Hopcroft's algorithm.
+//
+// The DFA is stored in a section of the program image, so it is saved and
+// loaded with the program. The section is laid out as follows:
+//   Header
+//   uint8_t  byte_classes[256]
+//   uint32_t transitions[n_states * n_classes]
+// Bytes that no transition of the regexp distinguishes share a class.
+// States are represented by the offset of their row of transitions, which
+// saves a multiplication per byte: the state reached from the state at `row` on
+// `byte` is at `transitions[row + byte_classes[byte]]`.
+// Accepting states are numbered first, so they are the rows before
+// `n_accepting * n_classes`.
+//
+// The DFA holds the states for two modes. Matching in full mode starts from
+// `full_start`. Matching anywhere starts from `anywhere_start`, whose states
+// also start a new match at every position. In that mode all accepting states
+// are merged, as matching stops at the first one reached.
+//
+// Like the `LazyDFA`, the DFA only finds where matches end.
+class DFA {
+ public:
+  // The maximum number of states, so that rows offsets fit in 32 bits.
+  static constexpr uint32_t kMaxStates = (1 << 24) - 1;
+  // Used for `dead_state` when the DFA has no dead state.
+  static constexpr uint32_t kNoState = UINT32_MAX;
+
+  struct Header {
+    uint32_t n_states;
+    uint32_t n_classes;
+    uint32_t n_accepting;
+    // The states below are rows offsets.
+    uint32_t full_start;
+    uint32_t anywhere_start;
+    // The state from which the full mode cannot accept anymore.
+    uint32_t dead_state;
+  };
+
+  DFA() : header_(nullptr), byte_classes_(nullptr), transitions_(nullptr) {}
+
+  // Build the section for `program` in `section`. Returns false if the subset
+  // construction needs more than `max_states` states.
+  static bool Build(vector<char>* section,
+                    const Program* program,
+                    uint32_t max_states);
+  // Check the section of `size` bytes at `section`, which must be aligned for
+  // the header.
+  static bool IsValidSection(const char* section, size_t size);
+
+  void SetSection(const char* section);
+
+  size_t n_states() const { return header_->n_states; }
+  size_t n_classes() const { return header_->n_classes; }
+  static size_t SectionSize(uint32_t n_states, uint32_t n_classes) {
+    return sizeof(Header) + 256 +
+        static_cast<size_t>(n_states) * n_classes * sizeof(uint32_t);
+  }
+
+  // Accessors to walk the states, as rows offsets.
+  uint32_t full_start() const { return header_->full_start; }
+  uint32_t anywhere_start() const { return header_->anywhere_start; }
+  uint32_t dead_state() const { return header_->dead_state; }
+  bool IsAccepting(uint32_t state) const {
+    return state < header_->n_accepting * header_->n_classes;
+  }
+  uint8_t ByteClass(uint8_t byte) const { return byte_classes_[byte]; }
+  uint32_t Next(uint32_t state, uint8_t byte) const {
+    return transitions_[state + byte_classes_[byte]];
+  }
+
+  bool MatchFull(const char* text, size_t text_size) const;
+  // Find the earliest end of a match in `text`.
+  bool MatchAnywhereEnd(pos_t* end, const char* text, size_t text_size) const;
+
+ private:
+  const Header* header_;
+  const uint8_t* byte_classes_;
+  const uint32_t* transitions_;
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_DFA_H_
@@ -13,12 +13,34 @@ M( print_re_tree         , false   , false ,                                   \
    "After parsing a regexp, print the regexp tree." )                          \
 M( print_automaton       , false   , false ,                                   \
    "After building the automaton for a regexp, print it." )                    \
+M( print_compilation_info, false   , false ,                                   \
+   "After compiling a regexp, print the compilation time and memory usage." )  \
 M( trace_matching        , false   , false ,                                   \
    "Trace the matching process.")
 
 #define REGIT_FLAGS_LIST(M)                                                    \
 M( parser_opt            , true    , true  ,                                   \
    "Enable parser optimisations." )                                            \
+M( use_lazy_dfa          , true    , true  ,                                   \
+   "Use the lazy DFA engine when possible." )                                  \
+M( use_bit_parallel      , true    , true  ,                                   \
+   "Use the bit-parallel engine for regexps small enough." )                   \
+M( use_aho_corasick      , true    , true  ,                                   \
+   "Use the Aho-Corasick engine for regexps only matching literals." )         \
+M( use_literal_search    , true    , true  ,                                   \
+   "Search for the literal prefix of regexps with memchr or memmem." )         \
+M( use_prefilter         , true    , true  ,                                   \
+   "Reject texts missing the literals required by regexps before matching." )  \
+M( use_teddy             , true    , true  ,                                   \
+   "Search for small sets of literals with SIMD shuffles when available." )    \
+M( use_reverse_suffix    , true    , true  ,                                   \
+   "Search for the literal suffix of regexps, and match backward from it." )   \
+M( use_reverse_dfa       , true    , true  ,                                   \
+   "Find where matches start with a lazy DFA running backward." )              \
+M( use_backtracker       , true    , true  ,                                   \
+   "Use the bounded backtracker instead of the simulation for short texts." )  \
+M( use_jit               , true    , true  ,                                   \
+   "Use the native code of regexps compiled with the JIT." )                   \
 REGIT_PRINT_FLAGS_LIST(M)
 
 // Declare all the flags.
@@ -0,0 +1,552 @@
+#include "jit.h"
+
+#include <string.h>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define REGIT_JIT_X64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace regit {
+namespace internal {
+
+constexpr size_t JIT::kMaxStates;
+
+
+#ifdef REGIT_JIT_X64
+
+// Generates x86-64 code in a buffer. Jumps are emitted with 32-bit offsets to
+// labels, which are resolved by `Finalize()` once all labels are bound.
+class Assembler {
+ public:
+  typedef size_t Label;
+
+  // The condition codes used, as encoded in `Jcc`.
+  enum Condition {
+    kAboveOrEqual = 0x3,
+    kEqual = 0x4,
+    kNotEqual = 0x5,
+    kBelowOrEqual = 0x6,
+    kAbove = 0x7
+  };
+
+  Label NewLabel() {
+    labels_.push_back(kUnbound);
+    return labels_.size() - 1;
+  }
+  void Bind(Label label) { labels_[label] = code_.size(); }
+  size_t LabelOffset(Label label) const { return labels_[label]; }
+
+  void Emit(initializer_list<uint8_t> bytes) {
+    code_.insert(code_.end(), bytes.begin(), bytes.end());
+  }
+  void Emit8(uint8_t value) { code_.push_back(value); }
+  void Emit16(uint16_t value) { EmitBytes(&value, sizeof(value)); }
+  void Emit32(uint32_t value) { EmitBytes(&value, sizeof(value)); }
+  void Emit64(uint64_t value) { EmitBytes(&value, sizeof(value)); }
+  void EmitBytes(const void* bytes, size_t size) {
+    const uint8_t* begin = static_cast<const uint8_t*>(bytes);
+    code_.insert(code_.end(), begin, begin + size);
+  }
+  // The offset of `label` from the end of the emitted offset, as used by
+  // jumps and rip-relative addressing.
+  void EmitRelative32(Label label) { EmitOffset32(label, kUnbound); }
+  // The offset of `label` from `base`.
+  void EmitOffset32(Label label, Label base) {
+    fixups_.push_back({code_.size(), label, base});
+    Emit32(0);
+  }
+  void Align(size_t alignment) {
+    while (code_.size() % alignment != 0) {
+      Emit8(0xcc);  // int3
+    }
+  }
+
+  void Jump(Label label) {
+    Emit8(0xe9);
+    EmitRelative32(label);
+  }
+  void JumpIf(Condition condition, Label label) {
+    Emit({0x0f, static_cast<uint8_t>(0x80 | condition)});
+    EmitRelative32(label);
+  }
+
+  void Finalize() {
+    for (const Fixup& fixup : fixups_) {
+      ASSERT(labels_[fixup.label] != kUnbound);
+      size_t base = (fixup.base == kUnbound) ? fixup.offset + sizeof(int32_t)
+                                             : labels_[fixup.base];
+      int32_t value = static_cast<int32_t>(labels_[fixup.label] - base);
+      memcpy(code_.data() + fixup.offset, &value, sizeof(value));
+    }
+  }
+
+  const vector<uint8_t>& code() const { return code_; }
+
+ private:
+  static constexpr size_t kUnbound = SIZE_MAX;
+
+  struct Fixup {
+    size_t offset;
+    Label label;
+    Label base;
+  };
+
+  vector<uint8_t> code_;
+  vector<size_t> labels_;
+  vector<Fixup> fixups_;
+};
+
+constexpr size_t Assembler::kUnbound;
+
+
+// Generates the functions for both modes of a DFA.
+//
+// The generated functions take the current position in `rdi` and the end of
+// the text in `rsi`. The character read is in `eax`. `r8` points to the byte
+// classes, and `rcx` and `rdx` are scratch registers.
+class CodeGenerator {
+ public:
+  typedef Assembler::Label Label;
+
+  explicit CodeGenerator(const DFA* dfa);
+
+  void Generate();
+
+  const vector<uint8_t>& code() const { return masm_.code(); }
+  size_t full_entry() const { return masm_.LabelOffset(full_entry_); }
+  size_t anywhere_entry() const { return masm_.LabelOffset(anywhere_entry_); }
+
+ private:
+  // Dispatching on more ranges of characters uses a jump table.
+  static constexpr size_t kMaxCompares = 6;
+  // The longest run of literal characters checked at once.
+  static constexpr size_t kMaxFusedLength = 16;
+
+  // Characters in [`low`, `high`] lead to `target`.
+  struct Range {
+    uint8_t low;
+    uint8_t high;
+    uint32_t target;
+  };
+
+  // How the code for a state dispatches on the next character.
+  struct StateCode {
+    uint32_t state;
+    vector<Range> ranges;
+    uint32_t default_target;
+    // The characters of the run of literal characters from this state, and
+    // the state reached after them. Only used in full mode.
+    string literal;
+    uint32_t literal_target;
+  };
+
+  void GenerateMode(bool full_mode, Label entry, uint32_t start);
+  void AnalyzeState(StateCode* code, bool full_mode) const;
+  // Returns true if the only character not leading to the dead state from
+  // `state` is `*c`, leading to `*next`.
+  bool HasSingleCharacter(uint32_t state, uint8_t* c, uint32_t* next) const;
+  void EmitState(const StateCode& code, bool full_mode, Label next);
+  void EmitLiteral(const StateCode& code);
+  void EmitRangeCheck(const Range& range, bool inverted, Label target);
+  void EmitJumpTable(const StateCode& code, bool full_mode);
+
+  // The label to jump to to reach `state`.
+  Label Target(uint32_t state, bool full_mode);
+  // The index of the state in `state_labels_`.
+  size_t Index(uint32_t state) const { return state / dfa_->n_classes(); }
+
+  const DFA* dfa_;
+  Assembler masm_;
+  Label full_entry_;
+  Label anywhere_entry_;
+  Label return_false_;
+  Label return_true_;
+  Label return_end_;
+  Label byte_classes_;
+  // The label of each state for the mode being generated.
+  vector<Label> state_labels_;
+  vector<bool> has_label_;
+  // The jump tables, with the label of each table and of its entries.
+  vector<pair<Label, vector<Label>>> jump_tables_;
+};
+
+constexpr size_t CodeGenerator::kMaxCompares;
+constexpr size_t CodeGenerator::kMaxFusedLength;
+
+
+CodeGenerator::CodeGenerator(const DFA* dfa)
+    : dfa_(dfa),
+      full_entry_(masm_.NewLabel()),
+      anywhere_entry_(masm_.NewLabel()),
+      return_false_(masm_.NewLabel()),
+      return_true_(masm_.NewLabel()),
+      return_end_(masm_.NewLabel()),
+      byte_classes_(masm_.NewLabel()) {}
+
+
+void CodeGenerator::Generate() {
+  masm_.Bind(return_false_);
+  masm_.Emit({0x31, 0xc0, 0xc3});  // xor eax, eax; ret
+  masm_.Bind(return_true_);
+  masm_.Emit({0xb8, 0x01, 0x00, 0x00, 0x00, 0xc3});  // mov eax, 1; ret
+  masm_.Bind(return_end_);
+  masm_.Emit({0x48, 0x89, 0xf8, 0xc3});  // mov rax, rdi; ret
+
+  GenerateMode(true, full_entry_, dfa_->full_start());
+  GenerateMode(false, anywhere_entry_, dfa_->anywhere_start());
+
+  masm_.Align(sizeof(int32_t));
+  for (const auto& jump_table : jump_tables_) {
+    masm_.Bind(jump_table.first);
+    for (Label entry : jump_table.second) {
+      masm_.EmitOffset32(entry, jump_table.first);
+    }
+  }
+  masm_.Bind(byte_classes_);
+  for (int c = 0; c < 256; c++) {
+    masm_.Emit8(dfa_->ByteClass(c));
+  }
+  masm_.Finalize();
+}
+
+
+CodeGenerator::Label CodeGenerator::Target(uint32_t state, bool full_mode) {
+  if (full_mode && (state == dfa_->dead_state())) {
+    return return_false_;
+  }
+  // Matching anywhere stops at the first accepting state.
+  if (!full_mode && dfa_->IsAccepting(state)) {
+    return return_end_;
+  }
+  size_t index = Index(state);
+  if (!has_label_[index]) {
+    state_labels_[index] = masm_.NewLabel();
+    has_label_[index] = true;
+  }
+  return state_labels_[index];
+}
+
+
+bool CodeGenerator::HasSingleCharacter(uint32_t state,
+                                       uint8_t* c, uint32_t* next) const {
+  bool found = false;
+  for (int i = 0; i < 256; i++) {
+    uint32_t target = dfa_->Next(state, i);
+    if (target == dfa_->dead_state()) {
+      continue;
+    }
+    if (found) {
+      return false;
+    }
+    found = true;
+    *c = i;
+    *next = target;
+  }
+  return found;
+}
+
+
+void CodeGenerator::AnalyzeState(StateCode* code, bool full_mode) const {
+  const uint32_t state = code->state;
+  // Ranges of characters with the same target.
+  code->ranges.clear();
+  for (int c = 0; c < 256; c++) {
+    uint32_t target = dfa_->Next(state, c);
+    if (!code->ranges.empty() && (code->ranges.back().target == target)) {
+      code->ranges.back().high = c;
+    } else {
+      code->ranges.push_back({static_cast<uint8_t>(c),
+                              static_cast<uint8_t>(c), target});
+    }
+  }
+  // The default target is the one reached from the most characters.
+  vector<pair<uint32_t, int>> counts;
+  for (const Range& range : code->ranges) {
+    int n_chars = range.high - range.low + 1;
+    bool counted = false;
+    for (auto& count : counts) {
+      if (count.first == range.target) {
+        count.second += n_chars;
+        counted = true;
+      }
+    }
+    if (!counted) {
+      counts.push_back(make_pair(range.target, n_chars));
+    }
+  }
+  code->default_target = counts[0].first;
+  int max_count = counts[0].second;
+  for (const auto& count : counts) {
+    if (count.second > max_count) {
+      code->default_target = count.first;
+      max_count = count.second;
+    }
+  }
+
+  code->literal.clear();
+  code->literal_target = DFA::kNoState;
+  if (full_mode && (dfa_->dead_state() != DFA::kNoState)) {
+    uint32_t current = state;
+    uint8_t c;
+    uint32_t next;
+    while ((code->literal.size() < kMaxFusedLength) &&
+           HasSingleCharacter(current, &c, &next)) {
+      code->literal += static_cast<char>(c);
+      current = next;
+    }
+    if (code->literal.size() >= 2) {
+      code->literal_target = current;
+    } else {
+      code->literal.clear();
+    }
+  }
+}
+
+
+void CodeGenerator::GenerateMode(bool full_mode, Label entry, uint32_t start) {
+  state_labels_.assign(dfa_->n_states(), 0);
+  has_label_.assign(dfa_->n_states(), false);
+
+  // Order the states depth-first, so that the code for a state is often
+  // followed by the code for the state it most likely goes to, which saves a
+  // jump.
+  vector<StateCode> codes;
+  vector<bool> ordered(dfa_->n_states(), false);
+  vector<uint32_t> stack(1, start);
+  while (!stack.empty()) {
+    uint32_t state = stack.back();
+    stack.pop_back();
+    if (ordered[Index(state)] ||
+        (full_mode && (state == dfa_->dead_state())) ||
+        (!full_mode && dfa_->IsAccepting(state))) {
+      continue;
+    }
+    ordered[Index(state)] = true;
+    codes.emplace_back();
+    StateCode* code = &codes.back();
+    code->state = state;
+    AnalyzeState(code, full_mode);
+    // Pushed last to be visited first.
+    stack.push_back(code->default_target);
+    for (auto range = code->ranges.rbegin();
+         range != code->ranges.rend();
+         range++) {
+      stack.push_back(range->target);
+    }
+    if (code->literal_target != DFA::kNoState) {
+      stack.push_back(code->literal_target);
+    }
+  }
+
+  masm_.Align(16);
+  masm_.Bind(entry);
+  masm_.Emit({0x4c, 0x8d, 0x05});  // lea r8, [rip + byte_classes]
+  masm_.EmitRelative32(byte_classes_);
+  if (codes.empty() || (codes[0].state != start)) {
+    masm_.Jump(Target(start, full_mode));
+  }
+  for (size_t i = 0; i < codes.size(); i++) {
+    // An unused label when the state is the last one.
+    Label next = (i + 1 < codes.size()) ? Target(codes[i + 1].state, full_mode)
+                                        : masm_.NewLabel();
+    EmitState(codes[i], full_mode, next);
+  }
+}
+
+
+void CodeGenerator::EmitLiteral(const StateCode& code) {
+  const size_t length = code.literal.size();
+  Label slow = masm_.NewLabel();
+  // Check that enough characters are left.
+  masm_.Emit({0x48, 0x8d, 0x47, static_cast<uint8_t>(length)});
+  // lea rax, [rdi + length]
+  masm_.Emit({0x48, 0x39, 0xf0});  // cmp rax, rsi
+  masm_.JumpIf(Assembler::kAbove, slow);
+  // Any other character leads to the dead state.
+  size_t offset = 0;
+  while (offset < length) {
+    const char* chars = code.literal.data() + offset;
+    size_t left = length - offset;
+    uint8_t disp = static_cast<uint8_t>(offset);
+    if (left >= 8) {
+      uint64_t value;
+      memcpy(&value, chars, sizeof(value));
+      masm_.Emit({0x48, 0xb9});  // mov rcx, imm64
+      masm_.Emit64(value);
+      masm_.Emit({0x48, 0x39, 0x4f, disp});  // cmp [rdi + disp], rcx
+      offset += 8;
+    } else if (left >= 4) {
+      uint32_t value;
+      memcpy(&value, chars, sizeof(value));
+      masm_.Emit({0x81, 0x7f, disp});  // cmp dword [rdi + disp], imm32
+      masm_.Emit32(value);
+      offset += 4;
+    } else if (left >= 2) {
+      uint16_t value;
+      memcpy(&value, chars, sizeof(value));
+      masm_.Emit({0x66, 0x81, 0x7f, disp});  // cmp word [rdi + disp], imm16
+      masm_.Emit16(value);
+      offset += 2;
+    } else {
+      masm_.Emit({0x80, 0x7f, disp});  // cmp byte [rdi + disp], imm8
+      masm_.Emit8(chars[0]);
+      offset += 1;
+    }
+    masm_.JumpIf(Assembler::kNotEqual, return_false_);
+  }
+  masm_.Emit({0x48, 0x89, 0xc7});  // mov rdi, rax
+  masm_.Jump(Target(code.literal_target, true));
+  masm_.Bind(slow);
+}
+
+
+void CodeGenerator::EmitRangeCheck(const Range& range, bool inverted,
+                                   Label target) {
+  const uint8_t low = range.low;
+  const uint8_t high = range.high;
+  if ((low == high) || (low == 0)) {
+    // cmp eax, imm
+    if (high < 0x80) {
+      masm_.Emit({0x83, 0xf8, high});
+    } else {
+      masm_.Emit8(0x3d);
+      masm_.Emit32(high);
+    }
+  } else {
+    // lea ecx, [rax - low]
+    if (low <= 0x80) {
+      masm_.Emit({0x8d, 0x48, static_cast<uint8_t>(-low)});
+    } else {
+      masm_.Emit({0x8d, 0x88});
+      masm_.Emit32(-static_cast<uint32_t>(low));
+    }
+    // cmp ecx, imm
+    uint8_t size = high - low;
+    if (size < 0x80) {
+      masm_.Emit({0x83, 0xf9, size});
+    } else {
+      masm_.Emit({0x81, 0xf9});
+      masm_.Emit32(size);
+    }
+  }
+  Assembler::Condition condition;
+  if (low == high) {
+    condition = inverted ? Assembler::kNotEqual : Assembler::kEqual;
+  } else {
+    condition = inverted ? Assembler::kAbove : Assembler::kBelowOrEqual;
+  }
+  masm_.JumpIf(condition, target);
+}
+
+
+void CodeGenerator::EmitJumpTable(const StateCode& code, bool full_mode) {
+  Label table = masm_.NewLabel();
+  vector<Label> entries(dfa_->n_classes());
+  vector<bool> has_entry(dfa_->n_classes(), false);
+  for (int c = 0; c < 256; c++) {
+    uint8_t byte_class = dfa_->ByteClass(c);
+    if (!has_entry[byte_class]) {
+      entries[byte_class] = Target(dfa_->Next(code.state, c), full_mode);
+      has_entry[byte_class] = true;
+    }
+  }
+  jump_tables_.push_back(make_pair(table, entries));
+  masm_.Emit({0x41, 0x0f, 0xb6, 0x04, 0x00});  // movzx eax, byte [r8 + rax]
+  masm_.Emit({0x48, 0x8d, 0x0d});  // lea rcx, [rip + table]
+  masm_.EmitRelative32(table);
+  masm_.Emit({0x48, 0x63, 0x14, 0x81});  // movsxd rdx, dword [rcx + rax * 4]
+  masm_.Emit({0x48, 0x01, 0xca});  // add rdx, rcx
+  masm_.Emit({0xff, 0xe2});  // jmp rdx
+}
+
+
+void CodeGenerator::EmitState(const StateCode& code, bool full_mode,
+                              Label next) {
+  masm_.Bind(Target(code.state, full_mode));
+  if (!code.literal.empty()) {
+    EmitLiteral(code);
+  }
+  masm_.Emit({0x48, 0x39, 0xf7});  // cmp rdi, rsi
+  masm_.JumpIf(Assembler::kAboveOrEqual,
+               (full_mode && dfa_->IsAccepting(code.state)) ? return_true_
+                                                            : return_false_);
+  masm_.Emit({0x0f, 0xb6, 0x07});  // movzx eax, byte [rdi]
+  masm_.Emit({0x48, 0x83, 0xc7, 0x01});  // add rdi, 1
+
+  vector<Range> checks;
+  for (const Range& range : code.ranges) {
+    if (range.target != code.default_target) {
+      checks.push_back(range);
+    }
+  }
+  Label default_target = Target(code.default_target, full_mode);
+  if (checks.size() > kMaxCompares) {
+    EmitJumpTable(code, full_mode);
+    return;
+  }
+  for (size_t i = 0; i < checks.size(); i++) {
+    Label target = Target(checks[i].target, full_mode);
+    // Fall through to the last target if it is next.
+    if ((i + 1 == checks.size()) && (target == next) &&
+        (default_target != next)) {
+      EmitRangeCheck(checks[i], true, default_target);
+      return;
+    }
+    EmitRangeCheck(checks[i], false, target);
+  }
+  if (default_target != next) {
+    masm_.Jump(default_target);
+  }
+}
+
+
+JIT* JIT::Compile(const DFA* dfa) {
+  if (dfa->n_states() > kMaxStates) {
+    return nullptr;
+  }
+  CodeGenerator generator(dfa);
+  generator.Generate();
+  const vector<uint8_t>& code = generator.code();
+
+  // The pages are never writable and executable at the same time.
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t mapped_size = (code.size() + page_size - 1) / page_size * page_size;
+  void* mapping = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+  memcpy(mapping, code.data(), code.size());
+  if (mprotect(mapping, mapped_size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(mapping, mapped_size);
+    return nullptr;
+  }
+  uintptr_t base = reinterpret_cast<uintptr_t>(mapping);
+  return new JIT(
+      mapping, mapped_size, code.size(),
+      reinterpret_cast<Function>(base + generator.full_entry()),
+      reinterpret_cast<Function>(base + generator.anywhere_entry()));
+}
+
+
+JIT::~JIT() {
+  munmap(mapping_, mapped_size_);
+}
+
+#else  // REGIT_JIT_X64
+
+JIT* JIT::Compile(const DFA* dfa) {
+  UNUSED(dfa);
+  return nullptr;
+}
+
+
+JIT::~JIT() {}
+
+#endif  // REGIT_JIT_X64
+
+
+} }  // namespace regit::internal
@@ -0,0 +1,69 @@
+#ifndef REGIT_JIT_H_
+#define REGIT_JIT_H_
+
+#include "dfa.h"
+#include "globals.h"
+#include "regit.h"
+
+namespace regit {
+namespace internal {
+
+// Native code compiled from a `DFA`, for x86-64.
+//
+// Each state of the DFA becomes a block of code reading the next character and
+// jumping directly to the block of the next state. Few distinct transitions are
+// dispatched with compares against immediates, and others with a jump table
+// indexed by the byte class. In full mode, runs of states accepting a single
+// character each (the literals of the regexp) are checked with a few wide loads
+// and compares against immediates, instead of one byte at a time.
+//
+// The code is generated in a buffer, then copied to pages mapped writable,
+// which are remapped executable (and not writable) before being used.
+// `Compile()` returns nullptr on other architectures or when executable memory
+// is not available, and the callers then use the DFA tables.
+class JIT {
+ public:
+  // DFAs with more states are not compiled, to bound the code size.
+  static constexpr size_t kMaxStates = 64 * 1024;
+
+  static JIT* Compile(const DFA* dfa);
+  ~JIT();
+
+  // Same as `DFA::MatchFull()` and `DFA::MatchAnywhereEnd()`.
+  bool MatchFull(const char* text, size_t text_size) const {
+    return full_(text, text + text_size) != 0;
+  }
+  bool MatchAnywhereEnd(pos_t* end, const char* text, size_t text_size) const {
+    *end = reinterpret_cast<pos_t>(anywhere_(text, text + text_size));
+    return *end != kInvalidPos;
+  }
+
+  // The size of the generated code, in bytes.
+  size_t code_size() const { return code_size_; }
+  // The memory used, in bytes.
+  size_t size() const { return sizeof(*this) + mapped_size_; }
+
+ private:
+  // The generated functions return 0 when there is no match. Otherwise the
+  // full mode function returns 1, and the anywhere mode function the end of
+  // the match.
+  typedef uintptr_t (*Function)(const char* text, const char* text_end);
+
+  JIT(void* mapping, size_t mapped_size, size_t code_size,
+      Function full, Function anywhere)
+      : mapping_(mapping), mapped_size_(mapped_size), code_size_(code_size),
+        full_(full), anywhere_(anywhere) {}
+
+  void* mapping_;
+  size_t mapped_size_;
+  size_t code_size_;
+  Function full_;
+  Function anywhere_;
+
+  DISALLOW_COPY_AND_ASSIGN(JIT);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_JIT_H_
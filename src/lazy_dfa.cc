@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <string.h>
+
+#include "lazy_dfa.h"
+
+namespace regit {
+namespace internal {
+
+constexpr int LazyDFA::kUnknownState;
+
+
+LazyDFA::LazyDFA(const Program* program, bool reversed)
+    : program_id_(program->id()), reversed_(reversed),
+      nfa_(program, reversed), n_classes_(program->n_byte_classes()),
+      cache_size_(0), start_states_{kUnknownState, kUnknownState},
+      last_flush_pos_(nullptr), n_flushes_(0), current_pos_(nullptr) {
+  memcpy(byte_classes_, program->byte_classes(), sizeof(byte_classes_));
+}
+
+
+LazyDFA::Result LazyDFA::MatchFull(const char* text, size_t text_size) {
+  ASSERT(!reversed_);
+  ResetForMatch(text);
+  int state = StartState(false);
+  const char* text_end = text + text_size;
+  for (current_pos_ = text; current_pos_ < text_end; current_pos_++) {
+    uint8_t c = *current_pos_;
+    int next = transitions_[TransitionIndex(state, c)];
+    if (next == kUnknownState) {
+      next = ComputeNext(state, c, false);
+      if (next == kGaveUpState) {
+        return kGaveUp;
+      }
+    }
+    state = next;
+    if (states_[state].n_nodes == 0) {
+      return kNoMatch;
+    }
+  }
+  return states_[state].accepting ? kMatch : kNoMatch;
+}
+
+
+LazyDFA::Result LazyDFA::MatchAnywhereEnd(pos_t* end,
+                                          const char* text, size_t text_size) {
+  ASSERT(!reversed_);
+  ResetForMatch(text);
+  int state = StartState(true);
+  const char* text_end = text + text_size;
+  for (current_pos_ = text; current_pos_ < text_end; current_pos_++) {
+    uint8_t c = *current_pos_;
+    int next = transitions_[TransitionIndex(state, c)];
+    if (next == kUnknownState) {
+      next = ComputeNext(state, c, true);
+      if (next == kGaveUpState) {
+        return kGaveUp;
+      }
+    }
+    state = next;
+    if (states_[state].accepting) {
+      *end = current_pos_ + 1;
+      return kMatch;
+    }
+  }
+  return kNoMatch;
+}
+
+
+LazyDFA::Result LazyDFA::MatchLongestEnd(pos_t* end, const char* text,
+                                         const char* last_start,
+                                         const char* text_end) {
+  ASSERT(!reversed_);
+  ResetForMatch(text);
+  Result result = kNoMatch;
+  // Matches can start at every position until `last_start`.
+  int state = StartState(text < last_start);
+  for (current_pos_ = text; current_pos_ < text_end; current_pos_++) {
+    bool reseed = current_pos_ < last_start;
+    if (current_pos_ == last_start) {
+      state = StopReseeding(state);
+    }
+    uint8_t c = *current_pos_;
+    int next = transitions_[TransitionIndex(state, c)];
+    if (next == kUnknownState) {
+      next = ComputeNext(state, c, reseed);
+      if (next == kGaveUpState) {
+        return kGaveUp;
+      }
+    }
+    state = next;
+    if (states_[state].accepting) {
+      *end = current_pos_ + 1;
+      result = kMatch;
+    }
+    if (!reseed && (states_[state].n_nodes == 0)) {
+      break;
+    }
+  }
+  return result;
+}
+
+
+LazyDFA::Result LazyDFA::MatchEarliestStart(pos_t* start,
+                                            const char* text, const char* end) {
+  ASSERT(reversed_);
+  ResetForMatch(end);
+  Result result = kNoMatch;
+  int state = StartState(false);
+  for (current_pos_ = end; current_pos_ > text; ) {
+    current_pos_--;
+    uint8_t c = *current_pos_;
+    int next = transitions_[TransitionIndex(state, c)];
+    if (next == kUnknownState) {
+      next = ComputeNext(state, c, false);
+      if (next == kGaveUpState) {
+        return kGaveUp;
+      }
+    }
+    state = next;
+    if (states_[state].accepting) {
+      *start = current_pos_;
+      result = kMatch;
+    }
+    if (states_[state].n_nodes == 0) {
+      break;
+    }
+  }
+  return result;
+}
+
+
+int LazyDFA::ComputeNext(int state, char c, bool reseed) {
+  ASSERT(next_nodes_.empty());
+  const uint32_t* nodes_begin = states_[state].nodes;
+  nfa_.Step(&next_nodes_, nodes_begin, nodes_begin + states_[state].n_nodes,
+            c, reseed);
+
+  if (cache_size_ > kMaxCacheSize) {
+    if (ShouldGiveUp()) {
+      next_nodes_.clear();
+      return kGaveUpState;
+    }
+    FlushCache();
+    // The transition cannot be recorded, as `state` has been flushed.
+    int next = AddState(next_nodes_, reseed);
+    next_nodes_.clear();
+    return next;
+  }
+  int next = AddState(next_nodes_, reseed);
+  next_nodes_.clear();
+  transitions_[TransitionIndex(state, c)] = next;
+  return next;
+}
+
+
+int LazyDFA::StartState(bool reseed) {
+  if (start_states_[reseed] == kUnknownState) {
+    vector<uint32_t> nodes(1, nfa_.entry_node());
+    start_states_[reseed] = AddState(nodes, reseed);
+  }
+  return start_states_[reseed];
+}
+
+
+int LazyDFA::StopReseeding(int state) {
+  vector<uint32_t> nodes(states_[state].nodes,
+                         states_[state].nodes + states_[state].n_nodes);
+  return AddState(nodes, false);
+}
+
+
+int LazyDFA::AddState(const vector<uint32_t>& nodes, bool reseed) {
+  // States that reseed and states that do not have different transitions, so
+  // they are distinguished even if they contain the same nodes.
+  string key(sizeof(uint32_t), reseed ? 1 : 0);
+  key.append(reinterpret_cast<const char*>(nodes.data()),
+             nodes.size() * sizeof(uint32_t));
+  unordered_map<string, int>::iterator it = index_.find(key);
+  if (it != index_.end()) {
+    return it->second;
+  }
+  int state = states_.size();
+  it = index_.insert(make_pair(key, state)).first;
+  bool accepting =
+      std::binary_search(nodes.begin(), nodes.end(), nfa_.exit_node());
+  const uint32_t* key_nodes =
+      reinterpret_cast<const uint32_t*>(it->first.data()) + 1;
+  states_.push_back({key_nodes, static_cast<uint32_t>(nodes.size()),
+                     accepting});
+  transitions_.resize(transitions_.size() + n_classes_, kUnknownState);
+  // Approximate the memory used by the state, including the index entry.
+  cache_size_ += sizeof(DState) + n_classes_ * sizeof(int) +
+      2 * key.size() + 4 * sizeof(void*);
+  return state;
+}
+
+
+void LazyDFA::FlushCache() {
+  last_flush_pos_ = current_pos_;
+  n_flushes_++;
+  start_states_[0] = kUnknownState;
+  start_states_[1] = kUnknownState;
+  states_.clear();
+  transitions_.clear();
+  index_.clear();
+  cache_size_ = 0;
+}
+
+
+bool LazyDFA::ShouldGiveUp() const {
+  if (n_flushes_ == 0) {
+    // The cache may have been filled by previous matches.
+    return false;
+  }
+  size_t bytes_since_flush = reversed_ ? last_flush_pos_ - current_pos_
+                                       : current_pos_ - last_flush_pos_;
+  return bytes_since_flush < kMinBytesPerState * states_.size();
+}
+
+
+} }  // namespace regit::internal
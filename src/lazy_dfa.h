@@ -0,0 +1,149 @@
+#ifndef REGIT_LAZY_DFA_H_
+#define REGIT_LAZY_DFA_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "byte_nfa.h"
+#include "globals.h"
+#include "program.h"
+#include "regit.h"
+
+namespace regit {
+namespace internal {
+
+// A DFA built lazily from a program, while matching.
+//
+// A DFA state is a set of nodes of the program's `ByteNFA`. DFA states and
+// their transitions are only computed when the text requires them, and are
+// cached in a table indexed by the DFA state and the byte class of the input
+// byte (see `Program::byte_classes()`), so that matching usually costs two
+// table lookups per byte. Indexing by class keeps the rows of the table short.
+//
+// The memory used by the cache is bounded. When it is exceeded the cache is
+// flushed. If this happens too often, the DFA gives up, and the caller should
+// fall back to the `Simulation`.
+//
+// The DFA only finds where matches end, without tracking where they start,
+// which keeps its states small. A second DFA, built from the reversed
+// `ByteNFA`, runs backward from the end of a match to find where it starts.
+// Finding the first match (see `Regit::MatchFirst()`) takes a third pass,
+// forward from the start of the earliest match, to find where the longest
+// match overlapping it ends.
+//
+// A lazy DFA is only used by one thread at a time (see `Scratch`).
+class LazyDFA {
+ public:
+  enum Result {
+    kNoMatch,
+    kMatch,
+    // The cache thrashed. The result is unknown.
+    kGaveUp
+  };
+
+  LazyDFA(const Program* program, bool reversed);
+
+  // Forward DFAs only.
+  Result MatchFull(const char* text, size_t text_size);
+  // Find the earliest end of a match in `text`.
+  Result MatchAnywhereEnd(pos_t* end, const char* text, size_t text_size);
+  // Find the latest end of a match in [`text`, `text_end`) starting in
+  // [`text`, `last_start`].
+  Result MatchLongestEnd(pos_t* end, const char* text, const char* last_start,
+                         const char* text_end);
+
+  // Reversed DFAs only. Find the earliest start of a match in [`text`, `end`)
+  // ending at `end`.
+  Result MatchEarliestStart(pos_t* start, const char* text, const char* end);
+
+  // The DFA does not keep a reference to the program, which may be destroyed
+  // before the DFA.
+  uint64_t program_id() const { return program_id_; }
+  bool reversed() const { return reversed_; }
+
+  // The number of DFA states currently cached.
+  size_t n_states() const { return states_.size(); }
+
+ private:
+  // The memory the cache can use before being flushed.
+#ifdef DEBUG
+  // Use a small cache to exercise flushing and falling back in tests.
+  static constexpr size_t kMaxCacheSize = 16 * 1024;
+#else
+  static constexpr size_t kMaxCacheSize = 2 * 1024 * 1024;
+#endif
+  // Give up when the cache needs to be flushed more than once during a match,
+  // and fewer bytes than this per DFA state have been matched since the
+  // previous flush.
+  static constexpr size_t kMinBytesPerState = 10;
+
+  static constexpr int kUnknownState = -1;
+  static constexpr int kGaveUpState = -2;
+
+  struct DState {
+    // The NFA nodes in the state, sorted. They are stored in the index key.
+    const uint32_t* nodes;
+    uint32_t n_nodes;
+    bool accepting;
+  };
+
+  // Compute the state reached from `state` when matching `c`.
+  // When `reseed` is true, the entry node is added to the new state, so that a
+  // new match can start at every position.
+  // Returns `kGaveUpState` if the cache thrashes.
+  int ComputeNext(int state, char c, bool reseed);
+  int AddState(const vector<uint32_t>& nodes, bool reseed);
+  // The state with the same nodes as `state`, which does not reseed.
+  int StopReseeding(int state);
+  // The state to start matching from. When `reseed` is true, matches can start
+  // at any position.
+  int StartState(bool reseed);
+  void FlushCache();
+  bool ShouldGiveUp() const;
+
+  // The index in `transitions_` of the transition from `state` on `c`.
+  size_t TransitionIndex(int state, uint8_t c) const {
+    return state * n_classes_ + byte_classes_[c];
+  }
+
+  void ResetForMatch(const char* text) {
+    last_flush_pos_ = text;
+    n_flushes_ = 0;
+  }
+
+  const uint64_t program_id_;
+  const bool reversed_;
+
+  const ByteNFA nfa_;
+  // Copied from the program.
+  uint8_t byte_classes_[256];
+  const int n_classes_;
+
+  // The DFA cache.
+  vector<DState> states_;
+  // `transitions_[TransitionIndex(state, byte)]` is the state reached from
+  // `state` when matching `byte`, or `kUnknownState`.
+  vector<int> transitions_;
+  // The node sets, encoded as strings prefixed with whether the state reseeds,
+  // to the index of their DFA state.
+  unordered_map<string, int> index_;
+  size_t cache_size_;
+  // Indexed by `reseed`.
+  int start_states_[2];
+
+  // Used to compute new states.
+  vector<uint32_t> next_nodes_;
+
+  // Information about the current match, to detect thrashing.
+  pos_t last_flush_pos_;
+  int n_flushes_;
+  pos_t current_pos_;
+
+  DISALLOW_COPY_AND_ASSIGN(LazyDFA);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_LAZY_DFA_H_
@@ -0,0 +1,47 @@
+#include "literal.h"
+
+namespace regit {
+namespace internal {
+
+pos_t Literal::Find(const char* begin, const char* end) const {
+  ASSERT(!literal_.empty());
+  if (begin >= end) {
+    return kInvalidPos;
+  }
+  const void* found;
+  if (literal_.size() == 1) {
+    found = memchr(begin, literal_[0], end - begin);
+  } else {
+    found = memmem(begin, end - begin, literal_.data(), literal_.size());
+  }
+  return static_cast<const char*>(found);
+}
+
+
+bool Literal::MatchAnywhere(Match* match,
+                            const char* text, size_t text_size) const {
+  pos_t start = Find(text, text + text_size);
+  if (start == kInvalidPos) {
+    return false;
+  }
+  match->start = start;
+  match->end = start + literal_.size();
+  return true;
+}
+
+
+bool Literal::MatchAll(vector<Match>* matches,
+                       const char* text, size_t text_size) const {
+  bool has_matched = false;
+  Match match;
+  const char* text_end = text + text_size;
+  while (MatchAnywhere(&match, text, text_end - text)) {
+    matches->push_back(match);
+    has_matched = true;
+    text = match.end;
+  }
+  return has_matched;
+}
+
+
+} }  // namespace regit::internal
@@ -0,0 +1,59 @@
+#ifndef REGIT_LITERAL_H_
+#define REGIT_LITERAL_H_
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "globals.h"
+#include "regit.h"
+
+namespace regit {
+namespace internal {
+
+// A literal searched with `memchr()` or `memmem()`, which the C library
+// implements with vector instructions.
+//
+// It is used for the literal prefix of programs, to only start matching at the
+// occurrences of the prefix, and to match programs that only match a literal
+// without running an automaton at all.
+class Literal {
+ public:
+  Literal() {}
+  explicit Literal(const string& literal) : literal_(literal) {}
+
+  const string& literal() const { return literal_; }
+  size_t size() const { return literal_.size(); }
+  bool empty() const { return literal_.empty(); }
+
+  // Returns the start of the first occurrence of the literal in
+  // [`begin`, `end`), or `kInvalidPos`. The literal must not be empty.
+  pos_t Find(const char* begin, const char* end) const;
+  bool IsAt(const char* text, const char* text_end) const {
+    return (static_cast<size_t>(text_end - text) >= literal_.size()) &&
+        !memcmp(text, literal_.data(), literal_.size());
+  }
+
+  // Matching functions, with the semantics of the engines for a program only
+  // matching the literal. Occurrences of a literal cannot end earlier or later
+  // than the first one starting at the same position, so `MatchFirst()` is the
+  // same as `MatchAnywhere()`.
+  bool MatchFull(const char* text, size_t text_size) const {
+    return (text_size == literal_.size()) && IsAt(text, text + text_size);
+  }
+  bool MatchAnywhere(Match* match, const char* text, size_t text_size) const;
+  bool MatchFirst(Match* match, const char* text, size_t text_size) const {
+    return MatchAnywhere(match, text, text_size);
+  }
+  bool MatchAll(vector<Match>* matches,
+                const char* text, size_t text_size) const;
+
+ private:
+  string literal_;
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_LITERAL_H_
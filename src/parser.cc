@@ -13,7 +13,10 @@ Regexp* Parser::Parse(const char* regexp, size_t regexp_size) {
   current_ = regexp;
   remaining_size_ = regexp_size;
 
+  // True when the last regexp pushed is a group, closed by a ')'.
+  bool after_group = false;
   while (*current_) {
+    bool is_group = (*current_ == ')');
     switch (*current_) {
       case '(':
         ConsumeLeftParenthesis();
@@ -36,6 +39,7 @@ Regexp* Parser::Parse(const char* regexp, size_t regexp_size) {
           case '*':
           case '+':
           case '.':
+          case '?':
           case '[':
           case ']':
           case '^':
@@ -58,7 +62,7 @@ Regexp* Parser::Parse(const char* regexp, size_t regexp_size) {
         return nullptr;
 
       case '.':
-        PushRegexp(new Period(options_->posix_period_));
+        PushRegexp(arena_->New<Period>(options_->posix_period_));
         Advance(1);
         break;
 
@@ -71,8 +75,8 @@ Regexp* Parser::Parse(const char* regexp, size_t regexp_size) {
         return nullptr;
 
       case '?':
-        ParseError(kParserUnsupported, "Unsupported '?' operator.");
-        return nullptr;
+        ConsumeQuestionMark(after_group);
+        break;
 
       case '^':
         ParseError(kParserUnsupported, "Unsupported '^' anchor.");
@@ -98,6 +102,7 @@ Regexp* Parser::Parse(const char* regexp, size_t regexp_size) {
     if (status_ != kSuccess) {
       return nullptr;
     }
+    after_group = is_group;
   }
 
   DoFinish();
@@ -126,13 +131,51 @@ void Parser::ConsumeChar() {
     }
   }
 
-  mc = new MultipleChar();
+  mc = arena_->New<MultipleChar>();
+  if (mc == nullptr) {
+    status_ = kOutOfMemory;
+    return;
+  }
   mc->PushChar(*current_);
   PushRegexp(mc);
   Advance(1);
 }
 
 
+void Parser::ConsumeQuestionMark(bool after_group) {
+  Regexp* re = tos();
+  if ((re == nullptr) || re->IsMarker()) {
+    Unexpected();
+    return;
+  }
+  if (!after_group && re->IsMultipleChar() &&
+      (re->AsMultipleChar()->NChars() > 1)) {
+    // Only the last character is optional.
+    MultipleChar* mc = arena_->New<MultipleChar>();
+    if (mc == nullptr) {
+      status_ = kOutOfMemory;
+      return;
+    }
+    mc->PushChar(re->AsMultipleChar()->PopChar());
+    re = mc;
+  } else {
+    PopRegexp();
+  }
+
+  // `x?` is `(x|)`, where the empty alternative is an epsilon transition.
+  Alternation* alternation = arena_->New<Alternation>(arena_);
+  Epsilon* epsilon = arena_->New<Epsilon>();
+  if ((alternation == nullptr) || (epsilon == nullptr)) {
+    status_ = kOutOfMemory;
+    return;
+  }
+  alternation->Append(re);
+  alternation->Append(epsilon);
+  PushRegexp(alternation);
+  Advance(1);
+}
+
+
 void Parser::ConsumeRightParenthesis() {
   if (open_parenthesis_.empty()) {
     ParseError(kParserMissingLeftParenthesis, "Unmatched closing parenthesis.");
@@ -188,7 +231,11 @@ void Parser::DoAlternation() {
       PushRegexp(alternated_regexps.front());
     }
   } else {
-    Alternation* alternation = new Alternation();
+    Alternation* alternation = arena_->New<Alternation>(arena_);
+    if (alternation == nullptr) {
+      status_ = kOutOfMemory;
+      return;
+    }
     alternation->sub_regexps()->assign(alternated_regexps.begin(),
                                        alternated_regexps.end());
     PushRegexp(alternation);
@@ -217,7 +264,11 @@ void Parser::DoConcatenation() {
   }
 
   ASSERT(first_re < stack_.end());
-  Concatenation* concatenation = new Concatenation();
+  Concatenation* concatenation = arena_->New<Concatenation>(arena_);
+  if (concatenation == nullptr) {
+    status_ = kOutOfMemory;
+    return;
+  }
   concatenation->sub_regexps()->insert(
       concatenation->sub_regexps()->end(), first_re, stack_.end());
 
@@ -3,6 +3,7 @@
 
 #include <stack>
 
+#include "arena.h"
 #include "regit.h"
 #include "regexp.h"
 
@@ -11,8 +12,9 @@ namespace internal {
 
 class Parser {
  public:
-  explicit Parser(const Options* options)
-      : options_(options), status_(kSuccess) {}
+  // The regexps are allocated in `arena`.
+  Parser(const Options* options, Arena* arena)
+      : options_(options), arena_(arena), status_(kSuccess) {}
 
   // The regexp must be '\0' terminated.
   Regexp* Parse(const char* regexp, size_t regexp_size);
@@ -20,6 +22,8 @@ class Parser {
   void ConsumeAlternateBar();
   void ConsumeChar();
   void ConsumeLeftParenthesis();
+  // `after_group` is true if the '?' follows a ')'.
+  void ConsumeQuestionMark(bool after_group);
   void ConsumeRightParenthesis();
 
   void DoAlternation();
@@ -72,19 +76,20 @@ class Parser {
   std::stack<size_t> alternate_bars_;
 
   const Options* options_;
+  Arena* arena_;
   Status status_;
 };
 
 inline void Parser::ConsumeAlternateBar() {
   DoConcatenation();
   alternate_bars_.push(stack_.size());
-  PushRegexp(new Regexp(kAlternateBar));
+  PushRegexp(arena_->New<Regexp>(kAlternateBar));
   Advance(1);
 }
 
 inline void Parser::ConsumeLeftParenthesis() {
   open_parenthesis_.push(stack_.size());
-  PushRegexp(new Regexp(kLeftParenthesis));
+  PushRegexp(arena_->New<Regexp>(kLeftParenthesis));
   Advance(1);
 }
 
@@ -95,6 +100,10 @@ inline void Parser::Advance(size_t n = 1) {
 }
 
 inline void Parser::PushRegexp(Regexp* regexp) {
+  if (regexp == nullptr) {
+    status_ = kOutOfMemory;
+    return;
+  }
   stack_.push_back(regexp);
 }
 
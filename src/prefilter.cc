@@ -0,0 +1,224 @@
+#include <algorithm>
+
+#include "prefilter.h"
+
+namespace regit {
+namespace internal {
+
+constexpr size_t RequiredLiteralsVisitor::kMaxExactLiterals;
+constexpr size_t RequiredLiteralsVisitor::kMaxRequiredLiterals;
+constexpr size_t RequiredLiteralsVisitor::kMinRequiredLiteralSize;
+
+
+// Beyond this size, longer literals hardly reject more texts, and fewer
+// literals are preferred.
+static constexpr size_t kGoodLiteralSize = 6;
+
+
+static size_t MinSize(const vector<string>& literals) {
+  size_t min_size = literals.empty() ? 0 : literals[0].size();
+  for (const string& literal : literals) {
+    min_size = min(min_size, literal.size());
+  }
+  return min_size;
+}
+
+
+static void SortAndRemoveDuplicates(vector<string>* literals) {
+  std::sort(literals->begin(), literals->end());
+  literals->erase(std::unique(literals->begin(), literals->end()),
+                  literals->end());
+}
+
+
+bool RequiredLiteralsVisitor::IsBetter(const vector<string>& a,
+                                       const vector<string>& b) {
+  size_t a_size = MinSize(a);
+  size_t b_size = MinSize(b);
+  if ((a_size == 0) || (b_size == 0)) {
+    return a_size > b_size;
+  }
+  size_t a_score = min(a_size, kGoodLiteralSize);
+  size_t b_score = min(b_size, kGoodLiteralSize);
+  if (a_score != b_score) {
+    return a_score > b_score;
+  }
+  if (a.size() != b.size()) {
+    return a.size() < b.size();
+  }
+  return a_size > b_size;
+}
+
+
+vector<string> RequiredLiteralsVisitor::required_literals() const {
+  if (MinSize(required_) < kMinRequiredLiteralSize) {
+    return vector<string>();
+  }
+  return required_;
+}
+
+
+void RequiredLiteralsVisitor::SetExact(const vector<string>& exact) {
+  has_exact_ = true;
+  exact_ = exact;
+  required_.clear();
+  if (exact.size() <= kMaxRequiredLiterals) {
+    required_ = exact;
+  }
+}
+
+
+void RequiredLiteralsVisitor::VisitMultipleChar(const MultipleChar* mc) {
+  SetExact(vector<string>(1, string(mc->Chars(), mc->NChars())));
+}
+
+
+void RequiredLiteralsVisitor::VisitPeriod(const Period*) {
+  has_exact_ = false;
+  exact_.clear();
+  required_.clear();
+}
+
+
+void RequiredLiteralsVisitor::VisitEpsilon(const Epsilon*) {
+  SetExact(vector<string>(1, string()));
+}
+
+
+void RequiredLiteralsVisitor::VisitConcatenation(
+    const Concatenation* concatenation) {
+  // `run` holds the texts matched by the current run of sub-regexps with
+  // exact sets. When the run is broken, its texts are required literals.
+  bool all_exact = true;
+  bool run_valid = true;
+  vector<string> run(1, string());
+  vector<string> required;
+  for (const Regexp* re : *concatenation->sub_regexps()) {
+    Visit(re);
+    if (IsBetter(required_, required)) {
+      required = required_;
+    }
+    if (run_valid && has_exact_ &&
+        (run.size() * exact_.size() <= kMaxExactLiterals)) {
+      vector<string> extended;
+      for (const string& prefix : run) {
+        for (const string& suffix : exact_) {
+          extended.push_back(prefix + suffix);
+        }
+      }
+      SortAndRemoveDuplicates(&extended);
+      run.swap(extended);
+      continue;
+    }
+    all_exact = false;
+    if (run_valid && (run.size() <= kMaxRequiredLiterals) &&
+        IsBetter(run, required)) {
+      required = run;
+    }
+    run_valid = has_exact_;
+    run = exact_;
+  }
+  if (run_valid && (run.size() <= kMaxRequiredLiterals) &&
+      IsBetter(run, required)) {
+    required = run;
+  }
+  has_exact_ = all_exact && run_valid;
+  exact_.clear();
+  if (has_exact_) {
+    exact_.swap(run);
+  }
+  required_.swap(required);
+}
+
+
+void RequiredLiteralsVisitor::VisitAlternation(const Alternation* alternation) {
+  // Each match contains a literal required by one of the alternatives.
+  bool all_exact = true;
+  bool all_required = true;
+  vector<string> exact;
+  vector<string> required;
+  for (const Regexp* re : *alternation->sub_regexps()) {
+    Visit(re);
+    if (all_exact && has_exact_) {
+      exact.insert(exact.end(), exact_.begin(), exact_.end());
+    } else {
+      all_exact = false;
+    }
+    if (all_required && !required_.empty()) {
+      required.insert(required.end(), required_.begin(), required_.end());
+    } else {
+      all_required = false;
+    }
+  }
+  SortAndRemoveDuplicates(&exact);
+  SortAndRemoveDuplicates(&required);
+  has_exact_ = all_exact && (exact.size() <= kMaxExactLiterals);
+  exact_.clear();
+  if (has_exact_) {
+    exact_ = exact;
+  }
+  required_.clear();
+  if (all_required && (required.size() <= kMaxRequiredLiterals)) {
+    required_.swap(required);
+  }
+  if (has_exact_ && (exact_.size() <= kMaxRequiredLiterals) &&
+      IsBetter(exact_, required_)) {
+    required_ = exact_;
+  }
+}
+
+
+Prefilter* Prefilter::Build(const Program* program) {
+  vector<string> literals = program->required_literals();
+  if (literals.empty()) {
+    return nullptr;
+  }
+  return new Prefilter(literals, program->max_match_length());
+}
+
+
+Prefilter::Prefilter(const vector<string>& literals, size_t max_match_length)
+    : teddy_(Teddy::Build(literals)),
+      min_literal_size_(MinSize(literals)),
+      max_match_length_(max_match_length) {
+  for (const string& literal : literals) {
+    literals_.push_back(Literal(literal));
+  }
+}
+
+
+bool Prefilter::Check(pos_t* start,
+                      const char* text, size_t text_size) const {
+  // Find the first occurrence of any of the literals. Once one has been found,
+  // the other literals are only searched before it.
+  const char* text_end = text + text_size;
+  pos_t first = kInvalidPos;
+  if (FLAG_use_teddy && (teddy_ != nullptr)) {
+    first = teddy_->Find(text, text_end);
+  } else {
+    for (const Literal& literal : literals_) {
+      const char* end = text_end;
+      if (first != kInvalidPos) {
+        end = first + min(literal.size() - 1,
+                          static_cast<size_t>(text_end - first));
+      }
+      pos_t found = literal.Find(text, end);
+      if (found != kInvalidPos) {
+        first = found;
+      }
+    }
+  }
+  if (first == kInvalidPos) {
+    return false;
+  }
+  // A match containing an occurrence at or after `first` ends at least
+  // `min_literal_size_` characters after `first`, and starts at most
+  // `max_match_length_` characters before its end.
+  size_t end_offset = (first - text) + min_literal_size_;
+  *start = text + ((end_offset > max_match_length_) ?
+                   end_offset - max_match_length_ : 0);
+  return true;
+}
+
+
+} }  // namespace regit::internal
@@ -0,0 +1,102 @@
+#ifndef REGIT_PREFILTER_H_
+#define REGIT_PREFILTER_H_
+
+#include <string>
+#include <vector>
+
+#include "globals.h"
+#include "literal.h"
+#include "program.h"
+#include "regexp.h"
+#include "regexp_visitor.h"
+#include "teddy.h"
+
+namespace regit {
+namespace internal {
+
+// Computes a set of literals such that every match of a regexp contains at
+// least one of them. For `(GET|POST) /api/(v1|v2)/users`, the best set is
+// {"/users"}, but {"GET /api/", "POST /api/"} would also do.
+//
+// For each sub-regexp, the visitor computes the set of texts it matches when it
+// is small (`exact`), and a set of required literals (`required`). Exact sets
+// of concatenated sub-regexps are combined while they stay small, and the best
+// set found along the way is kept.
+class RequiredLiteralsVisitor : public RegexpVisitor {
+ public:
+  // Limits on the sizes of the sets.
+  static constexpr size_t kMaxExactLiterals = 16;
+  static constexpr size_t kMaxRequiredLiterals = 8;
+  // Shorter literals are too frequent to reject texts efficiently.
+  static constexpr size_t kMinRequiredLiteralSize = 2;
+
+  RequiredLiteralsVisitor() : has_exact_(false) {}
+
+  // The required literals of the visited regexp. Empty if there is no set
+  // worth searching for.
+  vector<string> required_literals() const;
+
+#define DECLARE_REGEXP_VISITORS(RegexpType) \
+  void Visit##RegexpType(const RegexpType* r) OVERRIDE;
+  LIST_REAL_REGEXP_TYPES(DECLARE_REGEXP_VISITORS)
+#undef DECLARE_REGEXP_VISITORS
+
+ private:
+  // Returns true if `a` is a better set of required literals than `b`. Empty
+  // sets, or sets containing the empty string, are the worst.
+  static bool IsBetter(const vector<string>& a, const vector<string>& b);
+  void SetExact(const vector<string>& exact);
+
+  // The results for the last visited regexp.
+  bool has_exact_;
+  vector<string> exact_;
+  vector<string> required_;
+
+  DISALLOW_COPY_AND_ASSIGN(RequiredLiteralsVisitor);
+};
+
+
+// Rejects texts that contain none of the required literals of a program
+// before running any automaton, and skips the part of the text where no match
+// can start. A single literal is searched with `memchr()` or `memmem()`, and
+// several with `Teddy` when it is available.
+class Prefilter {
+ public:
+  // Returns nullptr if the program has no required literals.
+  static Prefilter* Build(const Program* program);
+  ~Prefilter() { delete teddy_; }
+
+  // Returns false if no match can be found in the text. Otherwise sets
+  // `*start` to the earliest position where a match can start.
+  bool Check(pos_t* start, const char* text, size_t text_size) const;
+
+  const vector<Literal>& literals() const { return literals_; }
+
+  // The memory used, in bytes.
+  size_t size() const {
+    size_t size = sizeof(*this) + literals_.capacity() * sizeof(Literal);
+    for (const Literal& literal : literals_) {
+      size += literal.size();
+    }
+    if (teddy_ != nullptr) {
+      size += teddy_->size();
+    }
+    return size;
+  }
+
+ private:
+  Prefilter(const vector<string>& literals, size_t max_match_length);
+
+  vector<Literal> literals_;
+  // Searches for all the literals at once, when there are several.
+  const Teddy* teddy_;
+  size_t min_literal_size_;
+  size_t max_match_length_;
+
+  DISALLOW_COPY_AND_ASSIGN(Prefilter);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_PREFILTER_H_
@@ -0,0 +1,468 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "program.h"
+
+namespace regit {
+namespace internal {
+
+constexpr char Program::kMagic[8];
+constexpr size_t Program::kMaxRequiredLiteralSize;
+
+static std::atomic<uint64_t> next_program_id(1);
+
+
+static size_t AlignUp(size_t size, size_t alignment) {
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+
+static Program::TransitionKind KindOf(const Regexp* re) {
+  if (re->IsMultipleChar()) {
+    return (re->AsMultipleChar()->NChars() == 1) ?
+        Program::kCharTransition : Program::kLiteralTransition;
+  }
+  ASSERT(re->type() == kPeriod);
+  return Program::kPeriodTransition;
+}
+
+
+// Calls `visit(re, exit)` for each transition from `state` once the epsilon
+// transitions are eliminated. The state gets the transitions of all the states
+// in its epsilon closure. A transition to a state whose closure holds the exit
+// state also gets a copy to the exit state, so that all the matches end there.
+template <typename Visitor>
+static void VisitTransitions(const Automaton* automaton, const State* state,
+                             Visitor visit) {
+  const ArenaVector<State*>* states = automaton->states();
+  const int exit_index = automaton->exit_state()->index();
+  for (const uint32_t* it = automaton->epsilon_closure_begin(state);
+       it < automaton->epsilon_closure_end(state);
+       it++) {
+    for (const Regexp* re : *states->at(*it)->from()) {
+      if (re->IsEpsilon()) {
+        continue;
+      }
+      visit(re, re->exit()->index());
+      if ((re->exit()->index() != exit_index) &&
+          automaton->ReachesExitState(re->exit())) {
+        visit(re, exit_index);
+      }
+    }
+  }
+}
+
+
+Program::Program(const Automaton* automaton,
+                 const Options* options,
+                 const string& regexp,
+                 const vector<string>& required_literals) {
+  const ArenaVector<State*>* states = automaton->states();
+  uint32_t n_transitions = 0;
+  uint32_t literals_size = 0;
+  for (const State* state : *states) {
+    VisitTransitions(automaton, state, [&](const Regexp* re, int) {
+      n_transitions++;
+      if (re->IsMultipleChar()) {
+        literals_size += re->AsMultipleChar()->NChars();
+      }
+    });
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order_mark = kByteOrderMark;
+  header.options = (options->posix_period_ ? kPosixPeriod : 0) |
+      (options->jit_ ? kJit : 0);
+  header.n_states = states->size();
+  header.n_transitions = n_transitions;
+  header.entry_state = automaton->entry_state()->index();
+  header.exit_state = automaton->exit_state()->index();
+  header.max_transition_match_length =
+      automaton->max_transition_match_length();
+  header.states_offset = sizeof(Header);
+  header.transitions_offset = AlignUp(
+      header.states_offset + (header.n_states + 1) * sizeof(uint32_t),
+      alignof(Transition));
+  header.literals_offset =
+      header.transitions_offset + n_transitions * sizeof(Transition);
+  header.literals_size = literals_size;
+  header.regexp_offset = header.literals_offset + literals_size;
+  header.regexp_size = regexp.size();
+  header.required_offset = header.regexp_offset + header.regexp_size;
+  for (const string& literal : required_literals) {
+    header.required_size +=
+        1 + min(literal.size(), kMaxRequiredLiteralSize);
+  }
+  header.image_size =
+      AlignUp(header.required_offset + header.required_size, kAlignment);
+  header.max_dfa_states = options->max_dfa_states_;
+
+  buffer_.resize(header.image_size / sizeof(uint64_t), 0);
+  char* image = reinterpret_cast<char*>(buffer_.data());
+  memcpy(image, &header, sizeof(header));
+  uint32_t* image_states =
+      reinterpret_cast<uint32_t*>(image + header.states_offset);
+  Transition* image_transitions =
+      reinterpret_cast<Transition*>(image + header.transitions_offset);
+  char* image_literals = image + header.literals_offset;
+
+  uint32_t transition_index = 0;
+  uint32_t literal_offset = 0;
+  for (const State* state : *states) {
+    image_states[state->index()] = transition_index;
+    VisitTransitions(automaton, state, [&](const Regexp* re, int exit) {
+      Transition* transition = &image_transitions[transition_index++];
+      transition->kind = KindOf(re);
+      transition->first_char = 0;
+      transition->length = re->MatchLength();
+      transition->exit = exit;
+      transition->literal = literal_offset;
+      if (re->IsMultipleChar()) {
+        const MultipleChar* mc = re->AsMultipleChar();
+        transition->first_char = mc->Chars()[0];
+        memcpy(image_literals + literal_offset, mc->Chars(), mc->NChars());
+        literal_offset += mc->NChars();
+      }
+    });
+  }
+  image_states[header.n_states] = transition_index;
+  memcpy(image + header.regexp_offset, regexp.data(), regexp.size());
+  char* required = image + header.required_offset;
+  for (const string& literal : required_literals) {
+    size_t size = min(literal.size(), kMaxRequiredLiteralSize);
+    *required++ = static_cast<char>(size);
+    memcpy(required, literal.data(), size);
+    required += size;
+  }
+
+  uint32_t max_match_length = 0;
+  bool acyclic = ComputeMaxMatchLength(image, &max_match_length);
+  ASSERT(acyclic);
+  UNUSED(acyclic);
+  reinterpret_cast<Header*>(image)->max_match_length = max_match_length;
+  SetImage(image);
+
+  // The JIT compiles the DFA, so it needs one even without a budget.
+  uint32_t max_dfa_states = options->max_dfa_states_;
+  if (options->jit_ && (max_dfa_states == 0)) {
+    max_dfa_states = kJitMaxDFAStates;
+  }
+  vector<char> dfa;
+  if ((max_dfa_states != 0) && DFA::Build(&dfa, this, max_dfa_states)) {
+    uint32_t dfa_offset = header.image_size;
+    buffer_.resize(AlignUp(dfa_offset + dfa.size(), kAlignment) /
+                   sizeof(uint64_t), 0);
+    image = reinterpret_cast<char*>(buffer_.data());
+    memcpy(image + dfa_offset, dfa.data(), dfa.size());
+    Header* image_header = reinterpret_cast<Header*>(image);
+    image_header->dfa_offset = dfa_offset;
+    image_header->dfa_size = dfa.size();
+    image_header->image_size = buffer_.size() * sizeof(uint64_t);
+    SetImage(image);
+  }
+}
+
+
+void Program::SetImage(const char* image) {
+  id_ = next_program_id++;
+  image_ = image;
+  header_ = reinterpret_cast<const Header*>(image);
+  states_ = reinterpret_cast<const uint32_t*>(image + header_->states_offset);
+  transitions_ = reinterpret_cast<const Transition*>(
+      image + header_->transitions_offset);
+  literals_ = image + header_->literals_offset;
+  if (header_->dfa_size != 0) {
+    dfa_.SetSection(image + header_->dfa_offset);
+  }
+  ComputePrefix();
+  ComputeByteClasses();
+}
+
+
+vector<string> Program::required_literals() const {
+  vector<string> literals;
+  const char* required = image_ + header_->required_offset;
+  const char* required_end = required + header_->required_size;
+  while (required < required_end) {
+    size_t size = static_cast<uint8_t>(*required++);
+    literals.push_back(string(required, size));
+    required += size;
+  }
+  return literals;
+}
+
+
+void Program::ComputePrefix() {
+  string prefix;
+  int state = entry_state();
+  // Programs are acyclic, so the prefix follows each state at most once.
+  for (int i = 0;
+       (i < n_states()) && (state != exit_state()) &&
+       (transitions_end(state) - transitions_begin(state) == 1) &&
+       (transitions_begin(state)->kind != kPeriodTransition);
+       i++) {
+    const Transition* transition = transitions_begin(state);
+    prefix.append(literal(transition), transition->length);
+    state = transition->exit;
+  }
+  prefix_ = Literal(prefix);
+  is_literal_ = !prefix.empty() && (state == exit_state()) &&
+      (transitions_begin(state) == transitions_end(state));
+}
+
+
+void Program::ComputeByteClasses() {
+  bool in_literal[256] = {false};
+  for (int i = 0; i < n_transitions(); i++) {
+    const Transition* transition = transitions_ + i;
+    if (transition->kind != kPeriodTransition) {
+      const char* chars = literal(transition);
+      for (int j = 0; j < transition->length; j++) {
+        in_literal[static_cast<uint8_t>(chars[j])] = true;
+      }
+    }
+  }
+  // Each character appearing in a literal has its own class. The others only
+  // differ by whether periods match them.
+  static constexpr int kPeriodMismatch = 256;
+  static constexpr int kPeriodMatch = 257;
+  int class_of_key[258];
+  std::fill(class_of_key, class_of_key + 258, -1);
+  n_byte_classes_ = 0;
+  for (int byte = 0; byte < 256; byte++) {
+    int key = byte;
+    if (!in_literal[byte]) {
+      key = (byte == '\n' || byte == '\r') ? kPeriodMismatch : kPeriodMatch;
+    }
+    if (class_of_key[key] == -1) {
+      class_of_key[key] = n_byte_classes_++;
+    }
+    byte_classes_[byte] = class_of_key[key];
+  }
+}
+
+
+bool Program::ComputeMaxMatchLength(const char* image,
+                                    uint32_t* max_match_length) {
+  // Iterative depth-first search, computing for each state the length of the
+  // longest path to the exit state.
+  static constexpr int64_t kUnvisited = -3;
+  static constexpr int64_t kInProgress = -2;
+  static constexpr int64_t kCannotReachExit = -1;
+  const Header* header = reinterpret_cast<const Header*>(image);
+  const uint32_t* states =
+      reinterpret_cast<const uint32_t*>(image + header->states_offset);
+  const Transition* transitions = reinterpret_cast<const Transition*>(
+      image + header->transitions_offset);
+  vector<int64_t> longest(header->n_states, kUnvisited);
+  vector<int> stack;
+  longest[header->exit_state] = 0;
+  stack.push_back(header->entry_state);
+  while (!stack.empty()) {
+    int state = stack.back();
+    if (longest[state] == kUnvisited) {
+      longest[state] = kInProgress;
+      for (const Transition* transition = transitions + states[state];
+           transition < transitions + states[state + 1];
+           transition++) {
+        if (longest[transition->exit] == kInProgress) {
+          return false;
+        }
+        if (longest[transition->exit] == kUnvisited) {
+          stack.push_back(transition->exit);
+        }
+      }
+      continue;
+    }
+    stack.pop_back();
+    if (longest[state] != kInProgress) {
+      // The state was pushed more than once, and has already been processed.
+      continue;
+    }
+    int64_t state_longest = kCannotReachExit;
+    for (const Transition* transition = transitions + states[state];
+         transition < transitions + states[state + 1];
+         transition++) {
+      if (longest[transition->exit] >= 0) {
+        state_longest = max(state_longest,
+                            longest[transition->exit] + transition->length);
+      }
+    }
+    longest[state] = state_longest;
+  }
+  *max_match_length =
+      static_cast<uint32_t>(max<int64_t>(longest[header->entry_state], 0));
+  return true;
+}
+
+
+bool Program::IsValidImage(const char* image, size_t size) {
+  if ((reinterpret_cast<uintptr_t>(image) % kAlignment != 0) ||
+      (size < sizeof(Header))) {
+    return false;
+  }
+  const Header* header = reinterpret_cast<const Header*>(image);
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) ||
+      (header->version != kVersion) ||
+      (header->byte_order_mark != kByteOrderMark) ||
+      (header->image_size > size) ||
+      (header->n_states == 0) ||
+      (header->entry_state >= header->n_states) ||
+      (header->exit_state >= header->n_states)) {
+    return false;
+  }
+  // Check that all the sections fit in the image, using 64-bit arithmetic to
+  // avoid overflows.
+  const uint64_t image_size = header->image_size;
+  if ((header->states_offset % alignof(uint32_t) != 0) ||
+      (header->transitions_offset % alignof(Transition) != 0) ||
+      (header->states_offset +
+       (header->n_states + uint64_t(1)) * sizeof(uint32_t) > image_size) ||
+      (header->transitions_offset +
+       uint64_t(header->n_transitions) * sizeof(Transition) > image_size) ||
+      (header->literals_offset + uint64_t(header->literals_size) >
+       image_size) ||
+      (header->regexp_offset + uint64_t(header->regexp_size) > image_size) ||
+      (header->required_offset + uint64_t(header->required_size) >
+       image_size) ||
+      (header->dfa_offset % alignof(DFA::Header) != 0) ||
+      (header->dfa_offset + uint64_t(header->dfa_size) > image_size)) {
+    return false;
+  }
+  const char* required = image + header->required_offset;
+  const char* required_end = required + header->required_size;
+  while (required < required_end) {
+    size_t size = static_cast<uint8_t>(*required);
+    if ((size == 0) ||
+        (size > static_cast<size_t>(required_end - required - 1))) {
+      return false;
+    }
+    required += 1 + size;
+  }
+  if ((header->dfa_size != 0) &&
+      !DFA::IsValidSection(image + header->dfa_offset, header->dfa_size)) {
+    return false;
+  }
+
+  // The states and transitions are checked before any `Program` is built
+  // from the image, as deriving the prefix and byte classes follows them.
+  const uint32_t* states =
+      reinterpret_cast<const uint32_t*>(image + header->states_offset);
+  const Transition* transitions = reinterpret_cast<const Transition*>(
+      image + header->transitions_offset);
+  const char* literals = image + header->literals_offset;
+  for (uint32_t i = 0; i < header->n_states; i++) {
+    if (states[i] > states[i + 1]) {
+      return false;
+    }
+  }
+  if ((states[0] != 0) || (states[header->n_states] != header->n_transitions)) {
+    return false;
+  }
+  // The engines size their buffers from the maximum transition length, so it
+  // must be exact.
+  uint32_t max_transition_match_length = 0;
+  for (uint32_t i = 0; i < header->n_transitions; i++) {
+    const Transition* transition = transitions + i;
+    if ((transition->exit >= header->n_states) ||
+        (transition->kind >= kNTransitionKinds)) {
+      return false;
+    }
+    max_transition_match_length =
+        max<uint32_t>(max_transition_match_length, transition->length);
+    switch (transition->kind) {
+      case kPeriodTransition:
+        if ((transition->length != 1) || (transition->first_char != 0)) {
+          return false;
+        }
+        break;
+      case kCharTransition:
+      case kLiteralTransition:
+        if ((transition->length == 0) ||
+            ((transition->length == 1) !=
+             (transition->kind == kCharTransition)) ||
+            (transition->literal + uint64_t(transition->length) >
+             header->literals_size) ||
+            (transition->first_char != literals[transition->literal])) {
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+  }
+  if (max_transition_match_length != header->max_transition_match_length) {
+    return false;
+  }
+  uint32_t max_match_length;
+  if (!ComputeMaxMatchLength(image, &max_match_length) ||
+      (max_match_length != header->max_match_length)) {
+    return false;
+  }
+  return true;
+}
+
+
+void Program::PrintInfo() const {
+  cout << "  // Number of states: " << n_states() << "\n"
+      << "  // Entry state: " << entry_state() << "\n"
+      << "  // Exit state: " << exit_state() << "\n"
+      << "  // Max transition match length: " << max_transition_match_length()
+      << "\n";
+}
+
+
+void Program::PrintTransition(const Transition* transition) const {
+  switch (transition->kind) {
+    case kPeriodTransition:
+      cout << ".";
+      break;
+    case kCharTransition:
+    case kLiteralTransition:
+      cout << string(literal(transition), transition->length);
+      break;
+    default:
+      UNREACHABLE();
+  }
+}
+
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+
+Status MappedFile::Map(const char* path) {
+  ASSERT(data_ == nullptr);
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return kIOError;
+  }
+  struct stat file_stat;
+  if ((fstat(fd, &file_stat) != 0) || (file_stat.st_size == 0)) {
+    close(fd);
+    return kIOError;
+  }
+  void* data =
+      mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return kIOError;
+  }
+  data_ = reinterpret_cast<const char*>(data);
+  size_ = file_stat.st_size;
+  return kSuccess;
+}
+
+
+} }  // namespace regit::internal
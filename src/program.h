@@ -0,0 +1,272 @@
+#ifndef REGIT_PROGRAM_H_
+#define REGIT_PROGRAM_H_
+
+#include <string.h>
+#include <vector>
+
+#include "automaton.h"
+#include "bytes.h"
+#include "dfa.h"
+#include "globals.h"
+#include "literal.h"
+#include "regit.h"
+
+namespace regit {
+namespace internal {
+
+// A compiled regexp, in a flat form that the matching engines run over.
+//
+// The program is a single contiguous image that only contains offsets, never
+// pointers. It can be written to a file, and mapped back (see `Regit::Save()`
+// and `Regit::Load()`) to match directly from the mapped pages.
+// The image is laid out as follows:
+//   Header
+//   uint32_t   states[n_states + 1]
+//   Transition transitions[n_transitions]
+//   char       literals[literals_size]
+//   char       regexp[regexp_size]
+//   char       required[required_size]
+//   char       dfa[dfa_size]
+// The transitions leaving state `i` are the range
+// [states[i], states[i + 1]) of the transitions array.
+// The required section holds the literals of which every match contains at
+// least one (see `Prefilter`), each preceded by its length on one byte.
+// The DFA section is only present when the regexp was compiled with a DFA
+// states budget or with the JIT, and the DFA fits in the budget (see `DFA`).
+// Integers use the host byte order. Images from hosts with a different byte
+// order are rejected when loading.
+class Program {
+ public:
+  static constexpr char kMagic[8] = {'R', 'E', 'G', 'I', 'T', 'P', 'R', 'G'};
+  static constexpr uint32_t kVersion = 6;
+  static constexpr uint32_t kByteOrderMark = 0x01020304;
+  // Images are aligned to this boundary, and their size is a multiple of it.
+  static constexpr size_t kAlignment = 8;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint32_t image_size;
+    uint32_t options;
+    uint32_t n_states;
+    uint32_t n_transitions;
+    uint32_t entry_state;
+    uint32_t exit_state;
+    uint32_t max_transition_match_length;
+    uint32_t states_offset;
+    uint32_t transitions_offset;
+    uint32_t literals_offset;
+    uint32_t literals_size;
+    uint32_t regexp_offset;
+    uint32_t regexp_size;
+    uint32_t required_offset;
+    uint32_t required_size;
+    // The length of the longest text matched by the regexp.
+    uint32_t max_match_length;
+    // `Options::max_dfa_states_`.
+    uint32_t max_dfa_states;
+    // Offset and size of the DFA section. The size is 0 when there is no DFA.
+    uint32_t dfa_offset;
+    uint32_t dfa_size;
+  };
+
+  // Bits of `Header::options`.
+  enum OptionsBits {
+    kPosixPeriod = 1 << 0,
+    kJit = 1 << 1
+  };
+
+  // The DFA states budget used for `Options::jit_` when
+  // `Options::max_dfa_states_` is 0.
+  static constexpr uint32_t kJitMaxDFAStates = 4096;
+
+  // The kinds of transitions, specialized by how they match.
+  enum TransitionKind {
+    // A period.
+    kPeriodTransition,
+    // A single character.
+    kCharTransition,
+    // A literal of more than one character.
+    kLiteralTransition,
+    kNTransitionKinds
+  };
+
+  struct Transition {
+    // A `TransitionKind`.
+    uint8_t kind;
+    // The first character of the literal for character and literal
+    // transitions. Most mismatches are rejected without reading the literals
+    // pool.
+    char first_char;
+    uint16_t length;
+    uint32_t exit;
+    // Offset in the literals pool, for character and literal transitions.
+    uint32_t literal;
+  };
+
+  // Longer required literals are truncated, which keeps them required.
+  static constexpr size_t kMaxRequiredLiteralSize = 255;
+
+  // Build the program for an automaton, in a buffer owned by the program.
+  Program(const Automaton* automaton,
+          const Options* options,
+          const string& regexp,
+          const vector<string>& required_literals);
+  // Use the image at `image`, owned by the caller. The image must have been
+  // validated with `IsValidImage()`.
+  explicit Program(const char* image) { SetImage(image); }
+
+  static bool IsValidImage(const char* image, size_t size);
+
+  const char* image() const { return image_; }
+  size_t image_size() const { return header_->image_size; }
+
+  int n_states() const { return header_->n_states; }
+  int n_transitions() const { return header_->n_transitions; }
+  int entry_state() const { return header_->entry_state; }
+  int exit_state() const { return header_->exit_state; }
+  int max_transition_match_length() const {
+    return header_->max_transition_match_length;
+  }
+  size_t max_match_length() const { return header_->max_match_length; }
+
+  // The literal starting all the matches, or nullptr if there is none. It is
+  // derived from the image, and not stored in it.
+  const Literal* prefix() const {
+    return prefix_.empty() ? nullptr : &prefix_;
+  }
+  // True if the program only matches its prefix.
+  bool is_literal() const { return is_literal_; }
+
+  // Bytes that no transition tells apart share a byte class, so that tables
+  // indexed by bytes can be indexed by classes instead. The classes are
+  // derived from the image, and not stored in it.
+  int n_byte_classes() const { return n_byte_classes_; }
+  const uint8_t* byte_classes() const { return byte_classes_; }
+  uint8_t byte_class(char c) const {
+    return byte_classes_[static_cast<uint8_t>(c)];
+  }
+
+  // The DFA built at compilation time, or nullptr.
+  const DFA* dfa() const {
+    return (header_->dfa_size != 0) ? &dfa_ : nullptr;
+  }
+
+  // An identifier unique to this program object in the process, so that data
+  // derived from the program can be cached without risking to reuse it for
+  // another program allocated at the same address.
+  uint64_t id() const { return id_; }
+
+  const Transition* transitions_begin(int state) const {
+    return transitions_ + states_[state];
+  }
+  const Transition* transitions_end(int state) const {
+    return transitions_ + states_[state + 1];
+  }
+
+  const char* literal(const Transition* transition) const {
+    return literals_ + transition->literal;
+  }
+
+  // Returns the number of characters matched by the transition at `text`, or
+  // -1 if the transition does not match. `text` must be before `text_end`.
+  int Match(const Transition* transition,
+            const char* text, const char* text_end) const {
+    switch (transition->kind) {
+      case kPeriodTransition:
+        return MatchPeriod(transition, text);
+      case kCharTransition:
+        return MatchChar(transition, text);
+      case kLiteralTransition:
+        return MatchLiteral(transition, text, text_end);
+      default:
+        UNREACHABLE();
+        return -1;
+    }
+  }
+
+  int MatchPeriod(const Transition*, const char* text) const {
+    return (*text != '\n' && *text != '\r') ? 1 : -1;
+  }
+  int MatchChar(const Transition* transition, const char* text) const {
+    return (*text == transition->first_char) ? 1 : -1;
+  }
+  int MatchLiteral(const Transition* transition,
+                   const char* text, const char* text_end) const {
+    return (*text == transition->first_char &&
+            (text_end - text >= transition->length) &&
+            EqualBytes(literal(transition) + 1, text + 1,
+                       transition->length - 1)) ?
+        transition->length : -1;
+  }
+
+  string regexp() const {
+    return string(image_ + header_->regexp_offset, header_->regexp_size);
+  }
+  vector<string> required_literals() const;
+  Options options() const {
+    return Options((header_->options & kPosixPeriod) != 0,
+                   header_->max_dfa_states,
+                   (header_->options & kJit) != 0);
+  }
+
+  void PrintInfo() const;
+  void PrintTransition(const Transition* transition) const;
+
+ private:
+  // Compute the length of the longest path from the entry state to the exit
+  // state of the image. Returns false if the states graph has a cycle. The
+  // states and transitions of the image must be valid.
+  static bool ComputeMaxMatchLength(const char* image,
+                                    uint32_t* max_match_length);
+  // Follow the single transitions from the entry state to compute the prefix.
+  void ComputePrefix();
+  void ComputeByteClasses();
+
+  // Derives the prefix and byte classes, so `image` must be valid.
+  void SetImage(const char* image);
+
+  // Only used for programs built from an automaton.
+  vector<uint64_t> buffer_;
+
+  uint64_t id_;
+  const char* image_;
+  const Header* header_;
+  // Pointers to the sections of the image, to avoid going through the header
+  // when matching.
+  const uint32_t* states_;
+  const Transition* transitions_;
+  const char* literals_;
+  DFA dfa_;
+  Literal prefix_;
+  bool is_literal_;
+  uint8_t byte_classes_[256];
+  int n_byte_classes_;
+
+  DISALLOW_COPY_AND_ASSIGN(Program);
+};
+
+
+// A read-only mapping of a file.
+class MappedFile {
+ public:
+  MappedFile() : data_(nullptr), size_(0) {}
+  ~MappedFile();
+
+  Status Map(const char* path);
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_PROGRAM_H_
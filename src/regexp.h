@@ -5,6 +5,8 @@
 #include <string.h>
 #include <vector>
 
+#include "arena.h"
+#include "bytes.h"
 #include "globals.h"
 
 using namespace std;
@@ -87,6 +89,7 @@ class RegexpVisitor;
 // The base class for Regexps.
 // The parser builds a tree of Regexps, that is then passed to a code generator
 // to generate some code matching the respresented regular expression.
+// Regexps are allocated in an arena, and are never destroyed individually.
 class Regexp {
  public:
   explicit Regexp(RegexpType type)
@@ -125,8 +128,11 @@ class Regexp {
 #define DECLARE_ACCEPT(Name)                                                   \
   void Accept(RegexpVisitor* visitor) const OVERRIDE
 
-  virtual int Match(const char* string) const {
-    UNUSED(string);
+  // Returns the number of characters matched at `text`, or -1. `text` must be
+  // before `text_end`.
+  virtual int Match(const char* text, const char* text_end) const {
+    UNUSED(text);
+    UNUSED(text_end);
     UNREACHABLE();
     return -1;
   }
@@ -168,12 +174,19 @@ class LeafRegexp : public Regexp {
 
 class MultipleChar : public LeafRegexp {
  public:
-  MultipleChar() : LeafRegexp(kMultipleChar) {
-    chars_.push_back('\0');
+#ifdef MC_MAX_ONE_CHAR
+  static constexpr size_t kMaxMCLength = 1;
+#else
+  static constexpr size_t kMaxMCLength = 32;
+#endif
+
+  MultipleChar() : LeafRegexp(kMultipleChar), n_chars_(0) {
+    chars_[0] = '\0';
   }
 
-  int Match(const char* string) const OVERRIDE {
-    if (!strncmp(Chars(), string, NChars())) {
+  int Match(const char* text, const char* text_end) const OVERRIDE {
+    if ((static_cast<size_t>(text_end - text) >= NChars()) &&
+        EqualBytes(Chars(), text, NChars())) {
       return NChars();
     } else {
       return -1;
@@ -181,30 +194,33 @@ class MultipleChar : public LeafRegexp {
   }
 
   bool IsFull() {
-#ifdef MC_MAX_ONE_CHAR
-    static constexpr size_t kMaxMCLength= 1;
-# else
-    static constexpr size_t kMaxMCLength= 32;
-#endif
     ASSERT(NChars() <= kMaxMCLength);
     return NChars() == kMaxMCLength;
   }
 
   void PushChar(char c) {
     ASSERT(!IsFull());
-    chars_.back() = c;
-    chars_.push_back('\0');
+    chars_[n_chars_++] = c;
+    chars_[n_chars_] = '\0';
   }
 
-  const char* Chars() const { return &chars_[0]; }
-  size_t NChars() const { return chars_.size() - 1; }
+  char PopChar() {
+    ASSERT(NChars() > 0);
+    char c = chars_[--n_chars_];
+    chars_[n_chars_] = '\0';
+    return c;
+  }
+
+  const char* Chars() const { return chars_; }
+  size_t NChars() const { return n_chars_; }
 
   int MatchLength() const OVERRIDE { return NChars(); }
 
   DECLARE_ACCEPT(MultipleChar);
 
  protected:
-  vector<char> chars_;
+  size_t n_chars_;
+  char chars_[kMaxMCLength + 1];
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MultipleChar);
@@ -216,8 +232,9 @@ class Period : public LeafRegexp {
   Period() : LeafRegexp(kPeriod), posix_(false) {}
   explicit Period(bool posix) : LeafRegexp(kPeriod), posix_(posix) {}
 
-  int Match(const char* string) const OVERRIDE {
-    if (*string != '\n' && *string != '\r') {
+  int Match(const char* text, const char* text_end) const OVERRIDE {
+    UNUSED(text_end);
+    if (*text != '\n' && *text != '\r') {
       return 1;
     } else {
       return -1;
@@ -253,6 +270,10 @@ class Epsilon : public ControlRegexp {
  public:
   Epsilon() : ControlRegexp(kEpsilon) {}
 
+  // Epsilon transitions are eliminated when building a program, so they are
+  // never matched against the text.
+  int MatchLength() const OVERRIDE { return 0; }
+
   DECLARE_ACCEPT(Epsilon);
 
  private:
@@ -262,23 +283,19 @@ class Epsilon : public ControlRegexp {
 
 class FlowRegexp : public Regexp {
  public:
-  explicit FlowRegexp(RegexpType regexp_type) : Regexp(regexp_type) {}
-  virtual ~FlowRegexp() {
-    vector<Regexp*>::iterator it;
-    for (it = sub_regexps_.begin(); it < sub_regexps_.end(); it++) {
-      (*it)->~Regexp();
-    }
-  }
+  FlowRegexp(RegexpType regexp_type, Arena* arena)
+      : Regexp(regexp_type),
+        sub_regexps_(ArenaAllocator<Regexp*>(arena)) {}
 
   void Append(Regexp* regexp) {
     sub_regexps_.push_back(regexp);
   }
 
-  vector<Regexp*>* sub_regexps() { return &sub_regexps_; }
-  vector<Regexp*> const * sub_regexps() const { return &sub_regexps_; }
+  ArenaVector<Regexp*>* sub_regexps() { return &sub_regexps_; }
+  ArenaVector<Regexp*> const * sub_regexps() const { return &sub_regexps_; }
 
  protected:
-  vector<Regexp*> sub_regexps_;
+  ArenaVector<Regexp*> sub_regexps_;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(FlowRegexp);
@@ -287,7 +304,7 @@ class FlowRegexp : public Regexp {
 
 class Concatenation : public FlowRegexp {
  public:
-  Concatenation() : FlowRegexp(kConcatenation) {}
+  explicit Concatenation(Arena* arena) : FlowRegexp(kConcatenation, arena) {}
 
   void Concatenate(Regexp* regexp) { Append(regexp); }
 
@@ -300,7 +317,7 @@ class Concatenation : public FlowRegexp {
 
 class Alternation : public FlowRegexp {
  public:
-  Alternation() : FlowRegexp(kAlternation) {}
+  explicit Alternation(Arena* arena) : FlowRegexp(kAlternation, arena) {}
 
   void Alternate(Regexp* regexp) { Append(regexp); }
 
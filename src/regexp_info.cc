@@ -0,0 +1,149 @@
+#include <chrono>
+
+#include "parser.h"
+#include "prefilter.h"
+#include "regexp_info.h"
+
+namespace regit {
+namespace internal {
+
+Status RegexpInfo::Compile(const string& regexp, const Options* options) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  Status status = DoCompile(regexp, options);
+  compilation_time_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  if ((status == kSuccess) && FLAG_print_compilation_info) {
+    PrintCompilationInfo();
+  }
+  return status;
+}
+
+
+Status RegexpInfo::DoCompile(const string& regexp, const Options* options) {
+  arena_.reset(new Arena());
+  Status status = BuildProgram(regexp, options);
+  arena_size_ = arena_->size();
+  arena_.reset();
+  if (status != kSuccess) {
+    return status;
+  }
+  size_ = sizeof(*this) + sizeof(*program_) + program_->image_size();
+  BuildEngines();
+  return kSuccess;
+}
+
+
+Status RegexpInfo::BuildProgram(const string& regexp, const Options* options) {
+  Parser parser(options, arena_.get());
+  Regexp* re = parser.Parse(regexp.c_str(), regexp.size());
+  if (re == nullptr) {
+    ASSERT(parser.status() != kSuccess);
+    return parser.status();
+  }
+  Automaton* automaton = arena_->New<Automaton>(re, arena_.get());
+  if (automaton == nullptr) {
+    return kOutOfMemory;
+  }
+  if (automaton->status() != kSuccess) {
+    return automaton->status();
+  }
+  RequiredLiteralsVisitor required_literals;
+  required_literals.Visit(re);
+  program_ = new Program(automaton, options, regexp,
+                         required_literals.required_literals());
+  if (program_ == nullptr) {
+    return kOutOfMemory;
+  }
+  return kSuccess;
+}
+
+
+void RegexpInfo::Load(const char* image, shared_ptr<const MappedFile> file) {
+  file_ = file;
+  program_ = new Program(image);
+  size_ = sizeof(*this) + sizeof(*program_);
+  BuildEngines();
+}
+
+
+void RegexpInfo::BuildEngines() {
+  if (BitParallel::CountPositions(program_) <= BitParallel::kMaxPositions) {
+    bit_parallel_ = new BitParallel(program_);
+    size_ += bit_parallel_->size();
+  }
+  prefilter_ = Prefilter::Build(program_);
+  if (prefilter_ != nullptr) {
+    size_ += prefilter_->size();
+  }
+  aho_corasick_ = AhoCorasick::Build(program_);
+  if (aho_corasick_ != nullptr) {
+    size_ += aho_corasick_->size();
+  }
+  reverse_suffix_ = ReverseSuffix::Build(program_);
+  if (reverse_suffix_ != nullptr) {
+    size_ += reverse_suffix_->size();
+  }
+  const DFA* dfa = program_->dfa();
+  if (program_->options().jit_ && (dfa != nullptr)) {
+    jit_ = JIT::Compile(dfa);
+    if (jit_ != nullptr) {
+      size_ += jit_->size();
+    }
+  }
+}
+
+
+void RegexpInfo::PrintCompilationInfo() const {
+  cout << "// Compilation time: " << compilation_time_ / 1000.0 << " us\n"
+      << "// Compiled size: " << size_ << " bytes\n"
+      << "//   arena (released): " << arena_size_ << " bytes\n"
+      << "//   program: " << program_->image_size() << " bytes, "
+      << program_->n_byte_classes() << " byte classes\n";
+  const DFA* dfa = program_->dfa();
+  if (dfa != nullptr) {
+    cout << "//     dfa: " << dfa->n_states() << " states, "
+        << dfa->n_classes() << " byte classes, "
+        << DFA::SectionSize(dfa->n_states(), dfa->n_classes()) << " bytes\n";
+  } else if (program_->options().max_dfa_states_ != 0) {
+    cout << "//     dfa: over the budget of "
+        << program_->options().max_dfa_states_ << " states\n";
+  }
+  const Literal* prefix = program_->prefix();
+  if (prefix != nullptr) {
+    cout << "//   literal prefix: " << prefix->size() << " bytes"
+        << (program_->is_literal() ? ", the whole regexp\n" : "\n");
+  }
+  if (prefilter_ != nullptr) {
+    cout << "//   prefilter:";
+    const char* separator = " ";
+    for (const Literal& literal : prefilter_->literals()) {
+      cout << separator << '"' << literal.literal() << '"';
+      separator = " | ";
+    }
+    cout << "\n";
+  }
+  if (bit_parallel_ != nullptr) {
+    cout << "//   bit-parallel engine: " << bit_parallel_->size() << " bytes\n";
+  }
+  if (aho_corasick_ != nullptr) {
+    cout << "//   aho-corasick: " << aho_corasick_->n_literals() << " literals, "
+        << aho_corasick_->n_states() << " states, "
+        << aho_corasick_->n_classes() << " byte classes, "
+        << aho_corasick_->size() << " bytes\n";
+  }
+  if (reverse_suffix_ != nullptr) {
+    cout << "//   literal suffix: " << reverse_suffix_->suffix().size()
+        << " bytes, searched in reverse: " << reverse_suffix_->size()
+        << " bytes\n";
+  }
+  if (jit_ != nullptr) {
+    cout << "//   jit: " << jit_->code_size() << " bytes of code, "
+        << jit_->size() << " bytes mapped\n";
+  } else if (program_->options().jit_) {
+    cout << "//   jit: not available\n";
+  }
+}
+
+
+} }  // namespace regit::internal
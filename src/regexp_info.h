@@ -1,33 +1,90 @@
 #ifndef REGIT_REGEXP_INFO_H_
 #define REGIT_REGEXP_INFO_H_
 
+#include <memory>
+
+#include "aho_corasick.h"
+#include "arena.h"
 #include "automaton.h"
+#include "bit_parallel.h"
+#include "jit.h"
+#include "prefilter.h"
+#include "program.h"
 #include "regexp.h"
+#include "reverse_suffix.h"
 
 namespace regit {
 namespace internal {
 
+// A compiled regexp. It is immutable once `Compile()` or `Load()` has
+// succeeded, and can be shared across threads and `Regit` objects.
 class RegexpInfo {
  public:
-  RegexpInfo() : regexp_(nullptr), automaton_(nullptr), compiled_(false) {}
+  RegexpInfo()
+      : program_(nullptr), prefilter_(nullptr), bit_parallel_(nullptr),
+        aho_corasick_(nullptr), reverse_suffix_(nullptr), jit_(nullptr),
+        size_(0), arena_size_(0), compilation_time_(0) {}
   ~RegexpInfo() {
-    delete regexp_;
+    delete jit_;
+    delete reverse_suffix_;
+    delete aho_corasick_;
+    delete bit_parallel_;
+    delete prefilter_;
+    delete program_;
   }
 
-  const Regexp* regexp() const { return regexp_; }
-  void set_regexp(Regexp* regexp) { regexp_ = regexp; }
+  Status Compile(const string& regexp, const Options* options);
+  // Use the program image at `image`, from the mapped file `file`. The image
+  // must have been validated.
+  void Load(const char* image, shared_ptr<const MappedFile> file);
+
+  const Program* program() const { return program_; }
+  // The filter rejecting texts without the required literals, or nullptr if
+  // the regexp has none.
+  const Prefilter* prefilter() const { return prefilter_; }
+  // The bit-parallel engine, or nullptr if the program is too large for it.
+  const BitParallel* bit_parallel() const { return bit_parallel_; }
+  // The Aho-Corasick engine, or nullptr if the program does not only match
+  // literals.
+  const AhoCorasick* aho_corasick() const { return aho_corasick_; }
+  // The reverse suffix search, or nullptr if the matches of the program do not
+  // all end with a literal, or if they start with one.
+  const ReverseSuffix* reverse_suffix() const { return reverse_suffix_; }
+  // The native code compiled from the DFA, or nullptr if the regexp was not
+  // compiled with the JIT, or if it is not available.
+  const JIT* jit() const { return jit_; }
 
-  const Automaton* automaton() const { return automaton_; }
-  void set_automaton(Automaton* automaton) { automaton_ = automaton; }
+  // The memory used by the compiled regexp, in bytes.
+  size_t size() const { return size_; }
+  // The time spent in `Compile()`, in nanoseconds.
+  uint64_t compilation_time() const { return compilation_time_; }
 
-  bool compiled() const { return compiled_; }
+  void PrintCompilationInfo() const;
 
  private:
-  const Regexp* regexp_;
-  const Automaton* automaton_;
+  Status DoCompile(const string& regexp, const Options* options);
+  Status BuildProgram(const string& regexp, const Options* options);
+  // Build the engines derived from the program.
+  void BuildEngines();
+
+  // All the objects only used during compilation, notably the regexp tree and
+  // the automaton, are allocated in the arena. It is released in one shot once
+  // the program has been built.
+  unique_ptr<Arena> arena_;
+  const Program* program_;
+  const Prefilter* prefilter_;
+  const BitParallel* bit_parallel_;
+  const AhoCorasick* aho_corasick_;
+  const ReverseSuffix* reverse_suffix_;
+  const JIT* jit_;
+  // Keeps the image of loaded programs mapped.
+  shared_ptr<const MappedFile> file_;
+  size_t size_;
+  // The memory that was used by the arena during compilation.
+  size_t arena_size_;
+  uint64_t compilation_time_;
 
-  // TODO: Multithreading support.
-  bool compiled_;
+  DISALLOW_COPY_AND_ASSIGN(RegexpInfo);
 };
 
 
@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <chrono>
+
+#include "parser.h"
+#include "regexp_set_info.h"
+
+namespace regit {
+namespace internal {
+
+constexpr uint32_t RegexpSetInfo::kNoRegexp;
+
+
+Status RegexpSetInfo::Compile(const vector<string>& regexps,
+                              const Options* options) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  Status status = DoCompile(regexps, options);
+  compilation_time_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  if ((status == kSuccess) && FLAG_print_compilation_info) {
+    PrintCompilationInfo();
+  }
+  return status;
+}
+
+
+Status RegexpSetInfo::DoCompile(const vector<string>& regexps,
+                                const Options* options) {
+  // Like for a single regexp, the regexp trees and the automaton are released
+  // once the NFA has been built.
+  Arena arena;
+  vector<Regexp*> trees;
+  for (const string& regexp : regexps) {
+    Parser parser(options, &arena);
+    Regexp* re = parser.Parse(regexp.c_str(), regexp.size());
+    if (re == nullptr) {
+      ASSERT(parser.status() != kSuccess);
+      return parser.status();
+    }
+    trees.push_back(re);
+  }
+  Automaton* automaton = arena.New<Automaton>(trees, &arena);
+  if (automaton == nullptr) {
+    return kOutOfMemory;
+  }
+  if (automaton->status() != kSuccess) {
+    return automaton->status();
+  }
+  BuildFrom(automaton);
+  arena_size_ = arena.size();
+  return kSuccess;
+}
+
+
+void RegexpSetInfo::BuildFrom(const Automaton* automaton) {
+  const ArenaVector<State*>* states = automaton->states();
+  const ArenaVector<State*>* exit_states = automaton->exit_states();
+  n_regexps_ = exit_states->size();
+  entry_node_ = automaton->entry_state()->index();
+
+  // Like in the `ByteNFA`, the first nodes are the states, and literals are
+  // chains of edges through intermediate nodes. Like in the `Program`, each
+  // state gets the transitions of the states in its epsilon closure.
+  vector<vector<Edge>> edges(states->size());
+  for (const State* state : *states) {
+    for (const uint32_t* it = automaton->epsilon_closure_begin(state);
+         it < automaton->epsilon_closure_end(state);
+         it++) {
+      for (const Regexp* re : *states->at(*it)->from()) {
+        uint32_t exit = re->exit()->index();
+        if (re->IsPeriod()) {
+          edges[state->index()].push_back({true, 0, exit});
+        } else if (re->IsMultipleChar()) {
+          const MultipleChar* mc = re->AsMultipleChar();
+          uint32_t from = state->index();
+          for (size_t i = 0; i < mc->NChars(); i++) {
+            uint32_t next;
+            if (i == mc->NChars() - 1) {
+              next = exit;
+            } else {
+              next = edges.size();
+              edges.push_back(vector<Edge>());
+            }
+            edges[from].push_back({false, mc->Chars()[i], next});
+            from = next;
+          }
+        }
+      }
+    }
+  }
+
+  // Index the edges leaving the entry node by byte.
+  vector<vector<uint32_t>> entry_targets(256);
+  for (const Edge& edge : edges[entry_node_]) {
+    for (int byte = 0; byte < 256; byte++) {
+      if (edge.Matches(static_cast<char>(byte))) {
+        entry_targets[byte].push_back(edge.next);
+      }
+    }
+  }
+  edges[entry_node_].clear();
+  for (const vector<uint32_t>& targets : entry_targets) {
+    entry_targets_begin_.push_back(entry_targets_.size());
+    entry_targets_.insert(entry_targets_.end(), targets.begin(), targets.end());
+  }
+  entry_targets_begin_.push_back(entry_targets_.size());
+
+  // A state ends the matches of the regexps whose exit state is in its
+  // closure.
+  vector<uint32_t> regexp_of_exit(states->size(), kNoRegexp);
+  for (uint32_t regexp = 0; regexp < n_regexps_; regexp++) {
+    regexp_of_exit[exit_states->at(regexp)->index()] = regexp;
+  }
+  for (uint32_t node = 0; node < edges.size(); node++) {
+    accepted_begin_.push_back(accepted_.size());
+    if (node >= states->size()) {
+      continue;
+    }
+    const State* state = states->at(node);
+    for (const uint32_t* it = automaton->epsilon_closure_begin(state);
+         it < automaton->epsilon_closure_end(state);
+         it++) {
+      if (regexp_of_exit[*it] != kNoRegexp) {
+        accepted_.push_back(regexp_of_exit[*it]);
+      }
+    }
+  }
+  accepted_begin_.push_back(accepted_.size());
+
+  for (const vector<Edge>& node_edges : edges) {
+    nodes_.push_back(edges_.size());
+    edges_.insert(edges_.end(), node_edges.begin(), node_edges.end());
+  }
+  nodes_.push_back(edges_.size());
+
+  size_ = sizeof(*this) +
+      (nodes_.size() + accepted_begin_.size() + accepted_.size() +
+       entry_targets_begin_.size() + entry_targets_.size()) * sizeof(uint32_t) +
+      edges_.size() * sizeof(Edge);
+}
+
+
+bool RegexpSetInfo::MatchAnywhere(vector<bool>* matching,
+                                  vector<Match>* matches,
+                                  const char* text, size_t text_size,
+                                  Scratch* scratch) const {
+  matching->assign(n_regexps_, false);
+  if (matches != nullptr) {
+    matches->assign(n_regexps_, {kInvalidPos, kInvalidPos});
+  }
+  // The active nodes are listed in `current`, and the earliest start of the
+  // matches reaching them is in `current_starts`. The nodes active after the
+  // current byte are built in `next` and `next_starts`. The starts of inactive
+  // nodes are `kInvalidPos`.
+  const size_t n_nodes = this->n_nodes();
+  uint32_t* current = scratch->RegexpSetNodes(2 * n_nodes);
+  uint32_t* next = current + n_nodes;
+  pos_t* current_starts = scratch->RegexpSetStarts(2 * n_nodes);
+  pos_t* next_starts = current_starts + n_nodes;
+  size_t n_current = 0;
+  size_t n_matched = 0;
+  const char* text_end = text + text_size;
+  for (const char* pos = text; pos < text_end; pos++) {
+    if (n_current == 0) {
+      // Skip the bytes starting no match.
+      while ((pos < text_end) &&
+             (entry_targets_begin_[static_cast<uint8_t>(*pos)] ==
+              entry_targets_begin_[static_cast<uint8_t>(*pos) + 1])) {
+        pos++;
+      }
+      if (pos == text_end) {
+        break;
+      }
+    }
+    size_t n_next = 0;
+    auto activate = [&](uint32_t node, pos_t start) {
+      if (next_starts[node] == kInvalidPos) {
+        next_starts[node] = start;
+        next[n_next++] = node;
+      } else {
+        next_starts[node] = min(next_starts[node], start);
+      }
+    };
+    const uint8_t c = *pos;
+    for (size_t i = 0; i < n_current; i++) {
+      uint32_t node = current[i];
+      pos_t start = current_starts[node];
+      current_starts[node] = kInvalidPos;
+      for (const Edge* edge = edges_begin(node);
+           edge < edges_end(node);
+           edge++) {
+        if (edge->Matches(c)) {
+          activate(edge->next, start);
+        }
+      }
+    }
+    for (uint32_t i = entry_targets_begin_[c];
+         i < entry_targets_begin_[c + 1];
+         i++) {
+      activate(entry_targets_[i], pos);
+    }
+    // All the matches ending after this byte are known, with their earliest
+    // start.
+    for (size_t i = 0; i < n_next; i++) {
+      uint32_t node = next[i];
+      for (uint32_t j = accepted_begin_[node];
+           j < accepted_begin_[node + 1];
+           j++) {
+        uint32_t regexp = accepted_[j];
+        if (!(*matching)[regexp]) {
+          (*matching)[regexp] = true;
+          n_matched++;
+          if (matches != nullptr) {
+            (*matches)[regexp].start = next_starts[node];
+            (*matches)[regexp].end = pos + 1;
+          }
+        } else if ((matches != nullptr) &&
+                   ((*matches)[regexp].end == pos + 1)) {
+          (*matches)[regexp].start =
+              min((*matches)[regexp].start, next_starts[node]);
+        }
+      }
+    }
+    std::swap(current, next);
+    std::swap(current_starts, next_starts);
+    n_current = n_next;
+    if (n_matched == n_regexps_) {
+      break;
+    }
+  }
+  for (size_t i = 0; i < n_current; i++) {
+    current_starts[current[i]] = kInvalidPos;
+  }
+  return n_matched != 0;
+}
+
+
+void RegexpSetInfo::PrintCompilationInfo() const {
+  cout << "// Compilation time: " << compilation_time_ / 1000.0 << " us\n"
+      << "// Compiled size: " << size_ << " bytes\n"
+      << "//   arena (released): " << arena_size_ << " bytes\n"
+      << "//   set of " << n_regexps_ << " regexps: " << n_nodes()
+      << " nodes, " << edges_.size() << " edges\n";
+}
+
+
+} }  // namespace regit::internal
@@ -0,0 +1,94 @@
+#ifndef REGIT_REGEXP_SET_INFO_H_
+#define REGIT_REGEXP_SET_INFO_H_
+
+#include <string>
+#include <vector>
+
+#include "automaton.h"
+#include "byte_nfa.h"
+#include "globals.h"
+#include "regit.h"
+#include "scratch.h"
+
+namespace regit {
+namespace internal {
+
+// A compiled set of regexps (see `RegitSet`). It is immutable once `Compile()`
+// has succeeded.
+//
+// The regexps are compiled into a single automaton, where they share the entry
+// state. It is flattened into a byte-level NFA like the `ByteNFA`, with the
+// epsilon closures folded in. The nodes where matches of regexps end list
+// them.
+//
+// Matching simulates the NFA once over the text, tracking for each active node
+// the earliest start of the matches reaching it. The nodes reached from the
+// entry node are indexed by byte, so that starting matches at each position
+// only visits the regexps that can start with the current byte. Matching stops
+// as soon as all the regexps have matched.
+class RegexpSetInfo {
+ public:
+  RegexpSetInfo()
+      : entry_node_(0), n_regexps_(0), size_(0), arena_size_(0),
+        compilation_time_(0) {}
+
+  Status Compile(const vector<string>& regexps, const Options* options);
+
+  size_t n_regexps() const { return n_regexps_; }
+
+  // Set `(*matching)[i]` if the regexp `i` matches in the text, and when
+  // `matches` is not nullptr, set `(*matches)[i]` to its earliest match.
+  // Returns true if any regexp matches.
+  bool MatchAnywhere(vector<bool>* matching, vector<Match>* matches,
+                     const char* text, size_t text_size,
+                     Scratch* scratch) const;
+
+  // The memory used by the compiled set, in bytes.
+  size_t size() const { return size_; }
+
+  void PrintCompilationInfo() const;
+
+ private:
+  typedef ByteNFA::Edge Edge;
+
+  static constexpr uint32_t kNoRegexp = UINT32_MAX;
+
+  Status DoCompile(const vector<string>& regexps, const Options* options);
+  void BuildFrom(const Automaton* automaton);
+
+  size_t n_nodes() const { return nodes_.size() - 1; }
+  const Edge* edges_begin(uint32_t node) const {
+    return edges_.data() + nodes_[node];
+  }
+  const Edge* edges_end(uint32_t node) const {
+    return edges_.data() + nodes_[node + 1];
+  }
+
+  // The edges from node `i` are at [`nodes_[i]`, `nodes_[i + 1]`) in
+  // `edges_`. The entry node has none: see `entry_targets_`.
+  vector<uint32_t> nodes_;
+  vector<Edge> edges_;
+  // The regexps whose matches end at node `i` are at
+  // [`accepted_begin_[i]`, `accepted_begin_[i + 1]`) in `accepted_`.
+  vector<uint32_t> accepted_begin_;
+  vector<uint32_t> accepted_;
+  // The nodes reached from the entry node when matching byte `b` are at
+  // [`entry_targets_begin_[b]`, `entry_targets_begin_[b + 1]`) in
+  // `entry_targets_`.
+  vector<uint32_t> entry_targets_begin_;
+  vector<uint32_t> entry_targets_;
+  uint32_t entry_node_;
+  size_t n_regexps_;
+
+  size_t size_;
+  // The memory that was used by the arena during compilation.
+  size_t arena_size_;
+  uint64_t compilation_time_;
+
+  DISALLOW_COPY_AND_ASSIGN(RegexpSetInfo);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_REGEXP_SET_INFO_H_
@@ -1,112 +1,513 @@
-#include "automaton.h"
-#include "parser.h"
+#include "backtracker.h"
+#include "cache.h"
+#include "lazy_dfa.h"
 #include "regexp_info.h"
+#include "regexp_set_info.h"
 #include "regit.h"
+#include "scratch.h"
+#include "simulation.h"
+#include "stream.h"
 
 namespace regit {
 
 const Options regit_default_options;
 
 Regit::Regit(const char* regexp) :
-    regexp_(regexp), regexp_size_(strlen(regexp)),
-    status_(kSuccess),
-    rinfo_(new internal::RegexpInfo()) {}
+    regexp_(regexp),
+    status_(kSuccess) {}
 
 Regit::Regit(const string& regexp) :
-    regexp_(regexp.c_str()), regexp_size_(regexp.size()),
-    status_(kSuccess),
-    rinfo_(new internal::RegexpInfo()) {}
+    regexp_(regexp),
+    status_(kSuccess) {}
 
-Regit::~Regit() {
-  delete rinfo_;
+Regit::~Regit() {}
+
+void Regit::Compile(const Options* options) const {
+  call_once(compiled_, &Regit::DoCompile, this, options);
 }
 
-void Regit::Compile(const Options* options) {
-  internal::Parser parser(options);
-  internal::Regexp* re = parser.Parse(regexp_, regexp_size_);
-  if (re == nullptr) {
-    ASSERT(parser.status() != kSuccess);
-    status_ = parser.status();
-    return;
+
+void Regit::DoCompile(const Options* options) const {
+  internal::RegexpCache* cache = internal::RegexpCache::Get();
+  string key;
+  if (cache->enabled()) {
+    key = internal::RegexpCache::Key(regexp_, *options);
+    rinfo_ = cache->Lookup(key);
+    if (rinfo_ != nullptr) {
+      return;
+    }
   }
-  rinfo_->set_regexp(re);
-  internal::Automaton* automaton = new internal::Automaton(re);
-  if (automaton == nullptr) {
+
+  internal::RegexpInfo* rinfo = new internal::RegexpInfo();
+  if (rinfo == nullptr) {
     status_ = kOutOfMemory;
     return;
   }
-  if (automaton->status() != kSuccess) {
+  status_ = rinfo->Compile(regexp_, options);
+  if (status_ != kSuccess) {
+    delete rinfo;
     return;
   }
-  rinfo_->set_automaton(automaton);
+  rinfo_.reset(rinfo);
+
+  if (cache->enabled()) {
+    rinfo_ = cache->Insert(key, rinfo_);
+  }
+}
+
+
+MatchContext::MatchContext() : scratch_(new internal::Scratch()) {}
+
+MatchContext::~MatchContext() {
+  delete scratch_;
+}
+
+
+static internal::Scratch* GetScratch(MatchContext* context) {
+  return (context != nullptr) ? context->scratch()
+                              : internal::Scratch::ForCurrentThread();
 }
 
 
-bool Regit::MatchFull(const string& text) {
-  return MatchFull(text.c_str(), text.size());
+// The backtracker replaces the simulation for short texts.
+static bool UseBacktracker(const internal::Program* program,
+                           size_t text_size) {
+  return FLAG_use_backtracker &&
+      internal::Backtracker::Fits(program, text_size);
 }
 
 
-bool Regit::MatchFull(const char* text, size_t text_size) {
-  if (!rinfo_->compiled()) {
-    Compile();
+// Returns false if the text contains none of the literals required by the
+// regexp. Otherwise skips the start of the text, where no match can start.
+static bool PassesPrefilter(const internal::RegexpInfo* rinfo,
+                            const char** text, size_t* text_size) {
+  const internal::Prefilter* prefilter = rinfo->prefilter();
+  if (!FLAG_use_prefilter || (prefilter == nullptr)) {
+    return true;
+  }
+  pos_t start;
+  if (!prefilter->Check(&start, *text, *text_size)) {
+    return false;
   }
+  *text_size -= start - *text;
+  *text = start;
+  return true;
+}
+
+
+bool Regit::MatchFull(const string& text, MatchContext* context) const {
+  return MatchFull(text.c_str(), text.size(), context);
+}
+
+
+bool Regit::MatchFull(const char* text, size_t text_size,
+                      MatchContext* context) const {
+  Compile();
   if (status_ != kSuccess) {
     return false;
   }
-  internal::Simulation simulation(rinfo_->automaton());
+  if (FLAG_use_literal_search && rinfo_->program()->is_literal()) {
+    return rinfo_->program()->prefix()->MatchFull(text, text_size);
+  }
+  // A full match starts at the start of the text, so the text is rejected if
+  // the prefilter skips it.
+  const char* filtered_text = text;
+  size_t filtered_text_size = text_size;
+  if (!PassesPrefilter(rinfo_.get(), &filtered_text, &filtered_text_size) ||
+      (filtered_text != text)) {
+    return false;
+  }
+  const internal::ReverseSuffix* reverse_suffix = rinfo_->reverse_suffix();
+  if (FLAG_use_reverse_suffix && (reverse_suffix != nullptr) &&
+      !reverse_suffix->MayMatchFull(text, text_size)) {
+    return false;
+  }
+  const internal::JIT* jit = rinfo_->jit();
+  if (FLAG_use_jit && (jit != nullptr)) {
+    return jit->MatchFull(text, text_size);
+  }
+  const internal::DFA* aot_dfa = rinfo_->program()->dfa();
+  if (aot_dfa != nullptr) {
+    return aot_dfa->MatchFull(text, text_size);
+  }
+  const internal::AhoCorasick* aho_corasick = rinfo_->aho_corasick();
+  if (FLAG_use_aho_corasick && (aho_corasick != nullptr)) {
+    return aho_corasick->MatchFull(text, text_size);
+  }
+  const internal::BitParallel* bit_parallel = rinfo_->bit_parallel();
+  if (FLAG_use_bit_parallel && (bit_parallel != nullptr)) {
+    return bit_parallel->MatchFull(text, text_size);
+  }
+  internal::Scratch* scratch = GetScratch(context);
+  if (FLAG_use_lazy_dfa) {
+    internal::LazyDFA* dfa = scratch->GetLazyDFA(rinfo_->program());
+    internal::LazyDFA::Result result = dfa->MatchFull(text, text_size);
+    if (result != internal::LazyDFA::kGaveUp) {
+      return result == internal::LazyDFA::kMatch;
+    }
+  }
+  if (UseBacktracker(rinfo_->program(), text_size)) {
+    internal::Backtracker backtracker(rinfo_->program(), scratch);
+    return backtracker.MatchFull(text, text_size);
+  }
+  internal::Simulation simulation(rinfo_->program(), scratch);
   return simulation.MatchFull(text, text_size);
 }
 
 
-bool Regit::MatchAnywhere(Match* match, const string& text) {
-  return MatchAnywhere(match, text.c_str(), text.size());
+// Find the match ending at `end`, when no match ends before `end`: the match
+// ending there with the earliest start, within the longest match length. The
+// reversed lazy DFA finds it backward from `end`. The simulation finds it
+// forward if the DFA gives up. Returns false if no match ends at `end`, which
+// only happens when `end` comes from the DFA of a loaded image that disagrees
+// with its program.
+static bool FindMatchEndingAt(Match* match,
+                              internal::Simulation* simulation,
+                              internal::Scratch* scratch,
+                              const internal::Program* program,
+                              const char* text, pos_t end) {
+  size_t window_size =
+      min(program->max_match_length(), static_cast<size_t>(end - text));
+  if (FLAG_use_reverse_dfa) {
+    internal::LazyDFA* reversed_dfa = scratch->GetLazyDFA(program, true);
+    internal::LazyDFA::Result result =
+        reversed_dfa->MatchEarliestStart(&match->start, end - window_size, end);
+    if (result == internal::LazyDFA::kNoMatch) {
+      return false;
+    }
+    if (result == internal::LazyDFA::kMatch) {
+      match->end = end;
+      return true;
+    }
+  }
+  return simulation->MatchAnywhere(match, end - window_size, window_size) &&
+         (match->end == end);
 }
 
 
-bool Regit::MatchAnywhere(Match* match, const char* text, size_t text_size) {
-  if (!rinfo_->compiled()) {
-    Compile();
+// Find the first match with the lazy DFAs, which do not track where matches
+// start, in four passes:
+//   - forward, the earliest end of a match;
+//   - backward from there, the earliest start of the matches ending there;
+//   - forward, the latest end of the matches starting at or before it;
+//   - backward from there, the earliest start of the matches ending there.
+static internal::LazyDFA::Result MatchFirstWithLazyDFAs(
+    Match* match, internal::Scratch* scratch, const internal::Program* program,
+    const char* text, size_t text_size) {
+  internal::LazyDFA* dfa = scratch->GetLazyDFA(program);
+  // `dfa` is the most recently used, so it is not evicted.
+  internal::LazyDFA* reversed_dfa = scratch->GetLazyDFA(program, true);
+  pos_t first_end;
+  internal::LazyDFA::Result result =
+      dfa->MatchAnywhereEnd(&first_end, text, text_size);
+  if (result != internal::LazyDFA::kMatch) {
+    return result;
+  }
+  // No match ends before `first_end`, so the matches starting at or before the
+  // start of the first one start within the longest match length before it.
+  const char* window = first_end -
+      min(program->max_match_length(), static_cast<size_t>(first_end - text));
+  pos_t first_start;
+  result = reversed_dfa->MatchEarliestStart(&first_start, window, first_end);
+  if (result != internal::LazyDFA::kMatch) {
+    ASSERT(result == internal::LazyDFA::kGaveUp);
+    return result;
   }
+  result = dfa->MatchLongestEnd(&match->end, window, first_start,
+                                text + text_size);
+  if (result != internal::LazyDFA::kMatch) {
+    ASSERT(result == internal::LazyDFA::kGaveUp);
+    return result;
+  }
+  result = reversed_dfa->MatchEarliestStart(&match->start, window, match->end);
+  ASSERT(result != internal::LazyDFA::kNoMatch);
+  return result;
+}
+
+
+bool Regit::MatchAnywhere(Match* match, const string& text,
+                          MatchContext* context) const {
+  return MatchAnywhere(match, text.c_str(), text.size(), context);
+}
+
+
+bool Regit::MatchAnywhere(Match* match, const char* text, size_t text_size,
+                          MatchContext* context) const {
+  Compile();
   if (status_ != kSuccess) {
     return false;
   }
-  internal::Simulation simulation(rinfo_->automaton());
+  if (FLAG_use_literal_search && rinfo_->program()->is_literal()) {
+    return rinfo_->program()->prefix()->MatchAnywhere(match, text, text_size);
+  }
+  if (!PassesPrefilter(rinfo_.get(), &text, &text_size)) {
+    return false;
+  }
+  const internal::Program* program = rinfo_->program();
+  internal::Scratch* scratch = GetScratch(context);
+  internal::Simulation simulation(program, scratch);
+  const internal::JIT* jit = rinfo_->jit();
+  if (FLAG_use_jit && (jit != nullptr)) {
+    pos_t end;
+    if (!jit->MatchAnywhereEnd(&end, text, text_size)) {
+      return false;
+    }
+    if (FindMatchEndingAt(match, &simulation, scratch, program, text, end)) {
+      return true;
+    }
+    return simulation.MatchAnywhere(match, text, text_size);
+  }
+  const internal::DFA* aot_dfa = program->dfa();
+  if (aot_dfa != nullptr) {
+    pos_t end;
+    if (!aot_dfa->MatchAnywhereEnd(&end, text, text_size)) {
+      return false;
+    }
+    if (FindMatchEndingAt(match, &simulation, scratch, program, text, end)) {
+      return true;
+    }
+    return simulation.MatchAnywhere(match, text, text_size);
+  }
+  const internal::AhoCorasick* aho_corasick = rinfo_->aho_corasick();
+  if (FLAG_use_aho_corasick && (aho_corasick != nullptr)) {
+    return aho_corasick->MatchAnywhere(match, text, text_size);
+  }
+  const internal::ReverseSuffix* reverse_suffix = rinfo_->reverse_suffix();
+  if (FLAG_use_reverse_suffix && (reverse_suffix != nullptr)) {
+    return reverse_suffix->MatchAnywhere(match, text, text_size, scratch);
+  }
+  const internal::BitParallel* bit_parallel = rinfo_->bit_parallel();
+  if (FLAG_use_bit_parallel && (bit_parallel != nullptr)) {
+    return bit_parallel->MatchAnywhere(match, text, text_size);
+  }
+  if (FLAG_use_lazy_dfa) {
+    internal::LazyDFA* dfa = scratch->GetLazyDFA(program);
+    pos_t end;
+    internal::LazyDFA::Result result =
+        dfa->MatchAnywhereEnd(&end, text, text_size);
+    if (result == internal::LazyDFA::kNoMatch) {
+      return false;
+    }
+    if (result == internal::LazyDFA::kMatch) {
+      return FindMatchEndingAt(match, &simulation, scratch, program, text,
+                               end);
+    }
+  }
+  if (UseBacktracker(program, text_size)) {
+    internal::Backtracker backtracker(program, scratch);
+    return backtracker.MatchAnywhere(match, text, text_size);
+  }
   return simulation.MatchAnywhere(match, text, text_size);
 }
 
 
-bool Regit::MatchFirst(Match* match, const string& text) {
-  return MatchFirst(match, text.c_str(), text.size());
+bool Regit::MatchFirst(Match* match, const string& text,
+                       MatchContext* context) const {
+  return MatchFirst(match, text.c_str(), text.size(), context);
 }
 
 
-bool Regit::MatchFirst(Match* match, const char* text, size_t text_size) {
-  if (!rinfo_->compiled()) {
-    Compile();
-  }
+bool Regit::MatchFirst(Match* match, const char* text, size_t text_size,
+                       MatchContext* context) const {
+  Compile();
   if (status_ != kSuccess) {
     return false;
   }
-  internal::Simulation simulation(rinfo_->automaton());
+  if (FLAG_use_literal_search && rinfo_->program()->is_literal()) {
+    return rinfo_->program()->prefix()->MatchFirst(match, text, text_size);
+  }
+  if (!PassesPrefilter(rinfo_.get(), &text, &text_size)) {
+    return false;
+  }
+  const internal::AhoCorasick* aho_corasick = rinfo_->aho_corasick();
+  if (FLAG_use_aho_corasick && (aho_corasick != nullptr)) {
+    return aho_corasick->MatchFirst(match, text, text_size);
+  }
+  const internal::ReverseSuffix* reverse_suffix = rinfo_->reverse_suffix();
+  if (FLAG_use_reverse_suffix && (reverse_suffix != nullptr)) {
+    return reverse_suffix->MatchFirst(match, text, text_size,
+                                      GetScratch(context));
+  }
+  const internal::BitParallel* bit_parallel = rinfo_->bit_parallel();
+  if (FLAG_use_bit_parallel && (bit_parallel != nullptr)) {
+    return bit_parallel->MatchFirst(match, text, text_size);
+  }
+  internal::Scratch* scratch = GetScratch(context);
+  if (FLAG_use_lazy_dfa && FLAG_use_reverse_dfa) {
+    internal::LazyDFA::Result result = MatchFirstWithLazyDFAs(
+        match, scratch, rinfo_->program(), text, text_size);
+    if (result != internal::LazyDFA::kGaveUp) {
+      return result == internal::LazyDFA::kMatch;
+    }
+  }
+  if (UseBacktracker(rinfo_->program(), text_size)) {
+    internal::Backtracker backtracker(rinfo_->program(), scratch);
+    return backtracker.MatchFirst(match, text, text_size);
+  }
+  internal::Simulation simulation(rinfo_->program(), scratch);
   return simulation.MatchFirst(match, text, text_size);
 }
 
 
-bool Regit::MatchAll(vector<Match>* matches, const string& text) {
-  return MatchAll(matches, text.c_str(), text.size());
+bool Regit::MatchAll(vector<Match>* matches, const string& text,
+                     MatchContext* context) const {
+  return MatchAll(matches, text.c_str(), text.size(), context);
 }
 
 
-bool Regit::MatchAll(vector<Match>* matches, const char* text, size_t text_size) {
-  if (!rinfo_->compiled()) {
-    Compile();
+bool Regit::MatchAll(vector<Match>* matches, const char* text, size_t text_size,
+                     MatchContext* context) const {
+  Compile();
+  if (status_ != kSuccess) {
+    return false;
+  }
+  if (FLAG_use_literal_search && rinfo_->program()->is_literal()) {
+    return rinfo_->program()->prefix()->MatchAll(matches, text, text_size);
+  }
+  if (!PassesPrefilter(rinfo_.get(), &text, &text_size)) {
+    return false;
+  }
+  const internal::AhoCorasick* aho_corasick = rinfo_->aho_corasick();
+  if (FLAG_use_aho_corasick && (aho_corasick != nullptr)) {
+    return aho_corasick->MatchAll(matches, text, text_size);
+  }
+  const internal::ReverseSuffix* reverse_suffix = rinfo_->reverse_suffix();
+  if (FLAG_use_reverse_suffix && (reverse_suffix != nullptr)) {
+    return reverse_suffix->MatchAll(matches, text, text_size,
+                                    GetScratch(context));
+  }
+  const internal::BitParallel* bit_parallel = rinfo_->bit_parallel();
+  if (FLAG_use_bit_parallel && (bit_parallel != nullptr)) {
+    return bit_parallel->MatchAll(matches, text, text_size);
+  }
+  internal::Scratch* scratch = GetScratch(context);
+  size_t n_matches = matches->size();
+  if (FLAG_use_lazy_dfa && FLAG_use_reverse_dfa) {
+    // If the DFAs give up, the other engines match the rest of the text.
+    const char* text_end = text + text_size;
+    internal::LazyDFA::Result result = internal::LazyDFA::kMatch;
+    Match match;
+    while (text < text_end) {
+      result = MatchFirstWithLazyDFAs(&match, scratch, rinfo_->program(),
+                                      text, text_end - text);
+      if (result != internal::LazyDFA::kMatch) {
+        break;
+      }
+      matches->push_back(match);
+      text = match.end;
+    }
+    if (result != internal::LazyDFA::kGaveUp) {
+      return matches->size() > n_matches;
+    }
+    text_size = text_end - text;
   }
+  bool has_matched = matches->size() > n_matches;
+  if (UseBacktracker(rinfo_->program(), text_size)) {
+    internal::Backtracker backtracker(rinfo_->program(), scratch);
+    return backtracker.MatchAll(matches, text, text_size) || has_matched;
+  }
+  internal::Simulation simulation(rinfo_->program(), scratch);
+  return simulation.MatchAll(matches, text, text_size) || has_matched;
+}
+
+
+RegitSet::RegitSet() : status_(kSuccess) {}
+
+RegitSet::~RegitSet() {}
+
+
+size_t RegitSet::Add(const string& regexp) {
+  regexps_.push_back(regexp);
+  return regexps_.size() - 1;
+}
+
+
+void RegitSet::Compile(const Options* options) const {
+  call_once(compiled_, &RegitSet::DoCompile, this, options);
+}
+
+
+void RegitSet::DoCompile(const Options* options) const {
+  internal::RegexpSetInfo* info = new internal::RegexpSetInfo();
+  if (info == nullptr) {
+    status_ = kOutOfMemory;
+    return;
+  }
+  status_ = info->Compile(regexps_, options);
+  if (status_ != kSuccess) {
+    delete info;
+    return;
+  }
+  info_.reset(info);
+}
+
+
+bool RegitSet::MatchAnywhere(vector<bool>* matching, const string& text,
+                             vector<Match>* matches,
+                             MatchContext* context) const {
+  return MatchAnywhere(matching, text.c_str(), text.size(), matches, context);
+}
+
+
+bool RegitSet::MatchAnywhere(vector<bool>* matching,
+                             const char* text, size_t text_size,
+                             vector<Match>* matches,
+                             MatchContext* context) const {
+  Compile();
+  if (status_ != kSuccess) {
+    matching->assign(regexps_.size(), false);
+    if (matches != nullptr) {
+      matches->assign(regexps_.size(), {kInvalidPos, kInvalidPos});
+    }
+    return false;
+  }
+  return info_->MatchAnywhere(matching, matches, text, text_size,
+                              GetScratch(context));
+}
+
+
+RegitStream::RegitStream(const Regit* regit) {
+  regit->Compile();
+  status_ = regit->status();
+  if (status_ != kSuccess) {
+    return;
+  }
+  rinfo_ = regit->rinfo_;
+  stream_.reset(new internal::Stream(rinfo_->program()));
+  if (stream_ == nullptr) {
+    status_ = kOutOfMemory;
+  }
+}
+
+RegitStream::~RegitStream() {}
+
+
+bool RegitStream::Feed(vector<StreamMatch>* matches, const string& chunk) {
+  return Feed(matches, chunk.c_str(), chunk.size());
+}
+
+
+bool RegitStream::Feed(vector<StreamMatch>* matches,
+                       const char* chunk, size_t chunk_size) {
   if (status_ != kSuccess) {
     return false;
   }
-  internal::Simulation simulation(rinfo_->automaton());
-  return simulation.MatchAll(matches, text, text_size);
+  return stream_->Feed(matches, chunk, chunk_size);
+}
+
+
+bool RegitStream::Finish(vector<StreamMatch>* matches) {
+  if (status_ != kSuccess) {
+    return false;
+  }
+  return stream_->Finish(matches);
+}
+
+
+void RegitStream::Reset() {
+  if (status_ == kSuccess) {
+    stream_->Reset();
+  }
 }
 
 
@@ -0,0 +1,172 @@
+#include <algorithm>
+
+#include "reverse_suffix.h"
+
+namespace regit {
+namespace internal {
+
+constexpr size_t ReverseSuffix::kMinSuffixSize;
+
+
+ReverseSuffix* ReverseSuffix::Build(const Program* program) {
+  if (program->prefix() != nullptr) {
+    return nullptr;
+  }
+  // Count the transitions entering each state, and remember one of them.
+  vector<int> n_entering(program->n_states(), 0);
+  vector<const Program::Transition*> entering(program->n_states(), nullptr);
+  vector<int> sources(program->n_states(), -1);
+  for (int state = 0; state < program->n_states(); state++) {
+    for (const Program::Transition* transition =
+             program->transitions_begin(state);
+         transition < program->transitions_end(state);
+         transition++) {
+      n_entering[transition->exit]++;
+      entering[transition->exit] = transition;
+      sources[transition->exit] = state;
+    }
+  }
+  // All the matches go through the transitions entering the states with a
+  // single entering transition, back from the exit state.
+  string suffix;
+  int state = program->exit_state();
+  while ((state != program->entry_state()) && (n_entering[state] == 1) &&
+         (entering[state]->kind != Program::kPeriodTransition)) {
+    const Program::Transition* transition = entering[state];
+    suffix.insert(0, program->literal(transition), transition->length);
+    state = sources[state];
+  }
+  if (suffix.size() < kMinSuffixSize) {
+    return nullptr;
+  }
+  return new ReverseSuffix(program, suffix);
+}
+
+
+ReverseSuffix::ReverseSuffix(const Program* program, const string& suffix)
+    : suffix_(suffix), max_match_length_(program->max_match_length()),
+      nfa_(program, true) {}
+
+
+pos_t ReverseSuffix::FindStart(const char* begin, const char* end,
+                               Scratch* scratch) const {
+  // Simulate the reversed NFA with sets of nodes. `added` flags the nodes of
+  // `next`, and is cleared after each step. Matches are not empty, so the exit
+  // node is only reached after a step.
+  const size_t n_nodes = nfa_.n_nodes();
+  uint32_t* current = scratch->ReverseSuffixNodes(2 * n_nodes);
+  uint32_t* next = current + n_nodes;
+  uint8_t* added = scratch->ReverseSuffixMarks(n_nodes);
+  size_t n_current = 1;
+  current[0] = nfa_.entry_node();
+  pos_t start = kInvalidPos;
+  for (const char* pos = end; (pos > begin) && (n_current != 0); ) {
+    pos--;
+    size_t n_next = 0;
+    bool accepted = false;
+    for (size_t i = 0; i < n_current; i++) {
+      for (const Edge* edge = nfa_.edges_begin(current[i]);
+           edge < nfa_.edges_end(current[i]);
+           edge++) {
+        if (edge->Matches(*pos) && !added[edge->next]) {
+          added[edge->next] = 1;
+          next[n_next++] = edge->next;
+          accepted |= (edge->next == nfa_.exit_node());
+        }
+      }
+    }
+    for (size_t i = 0; i < n_next; i++) {
+      added[next[i]] = 0;
+    }
+    if (accepted) {
+      start = pos;
+    }
+    std::swap(current, next);
+    n_current = n_next;
+  }
+  return start;
+}
+
+
+pos_t ReverseSuffix::FindEarliestEnd(pos_t* start,
+                                     const char* begin, const char* end,
+                                     Scratch* scratch) const {
+  for (pos_t occurrence = suffix_.Find(begin, end);
+       occurrence != kInvalidPos;
+       occurrence = suffix_.Find(occurrence + 1, end)) {
+    pos_t match_end = occurrence + suffix_.size();
+    *start = FindStart(begin, match_end, scratch);
+    if (*start != kInvalidPos) {
+      return match_end;
+    }
+  }
+  return kInvalidPos;
+}
+
+
+bool ReverseSuffix::MatchAnywhere(Match* match,
+                                  const char* text, size_t text_size,
+                                  Scratch* scratch) const {
+  pos_t start;
+  pos_t end = FindEarliestEnd(&start, text, text + text_size, scratch);
+  if (end == kInvalidPos) {
+    return false;
+  }
+  match->start = start;
+  match->end = end;
+  return true;
+}
+
+
+bool ReverseSuffix::MatchFirst(Match* match,
+                               const char* text, size_t text_size,
+                               Scratch* scratch) const {
+  // Like `Simulation::MatchFirst()`: among the matches starting at or before
+  // the start of the match ending first, prefer the one ending last, and then
+  // the one starting first.
+  const char* text_end = text + text_size;
+  pos_t first_start;
+  pos_t first_end = FindEarliestEnd(&first_start, text, text_end, scratch);
+  if (first_end == kInvalidPos) {
+    return false;
+  }
+  // The matches starting at or before `first_start` end at the end of an
+  // occurrence of the suffix, at most `max_match_length_` characters after
+  // `first_start`.
+  const char* last_end =
+      first_start + min(max_match_length_,
+                        static_cast<size_t>(text_end - first_start));
+  match->start = first_start;
+  match->end = first_end;
+  for (pos_t occurrence = suffix_.Find(first_end - suffix_.size() + 1,
+                                       last_end);
+       occurrence != kInvalidPos;
+       occurrence = suffix_.Find(occurrence + 1, last_end)) {
+    pos_t end = occurrence + suffix_.size();
+    pos_t start = FindStart(text, end, scratch);
+    if ((start != kInvalidPos) && (start <= first_start)) {
+      match->start = start;
+      match->end = end;
+    }
+  }
+  return true;
+}
+
+
+bool ReverseSuffix::MatchAll(vector<Match>* matches,
+                             const char* text, size_t text_size,
+                             Scratch* scratch) const {
+  bool has_matched = false;
+  Match match;
+  const char* text_end = text + text_size;
+  while ((text < text_end) &&
+         MatchFirst(&match, text, text_end - text, scratch)) {
+    matches->push_back(match);
+    has_matched = true;
+    text = match.end;
+  }
+  return has_matched;
+}
+
+
+} }  // namespace regit::internal
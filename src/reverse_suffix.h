@@ -0,0 +1,78 @@
+#ifndef REGIT_REVERSE_SUFFIX_H_
+#define REGIT_REVERSE_SUFFIX_H_
+
+#include <vector>
+
+#include "byte_nfa.h"
+#include "globals.h"
+#include "literal.h"
+#include "program.h"
+#include "regit.h"
+#include "scratch.h"
+
+namespace regit {
+namespace internal {
+
+// A search strategy for programs whose matches all end with a literal, but do
+// not start with one, like `.....-error`.
+//
+// The occurrences of the suffix are found with `memchr()` or `memmem()`. From
+// the end of each occurrence, the reversed `ByteNFA` of the program runs
+// backward over the text to confirm that a match ends there, and to find where
+// it starts. Matches end in increasing order of the occurrences of the suffix,
+// so the first confirmed occurrence ends the earliest match.
+class ReverseSuffix {
+ public:
+  // Shorter suffixes are too frequent to be worth searching for.
+  static constexpr size_t kMinSuffixSize = 2;
+
+  // Returns nullptr if the program has a literal prefix, or if its matches do
+  // not all end with a literal of at least `kMinSuffixSize` characters.
+  static ReverseSuffix* Build(const Program* program);
+
+  // Returns false if the text cannot match, because it does not end with the
+  // suffix. The other engines must be used otherwise.
+  bool MayMatchFull(const char* text, size_t text_size) const {
+    return (text_size >= suffix_.size()) &&
+        suffix_.IsAt(text + text_size - suffix_.size(), text + text_size);
+  }
+  bool MatchAnywhere(Match* match, const char* text, size_t text_size,
+                     Scratch* scratch) const;
+  bool MatchFirst(Match* match, const char* text, size_t text_size,
+                  Scratch* scratch) const;
+  bool MatchAll(vector<Match>* matches, const char* text, size_t text_size,
+                Scratch* scratch) const;
+
+  const Literal& suffix() const { return suffix_; }
+
+  // The memory used, in bytes.
+  size_t size() const {
+    return sizeof(*this) - sizeof(nfa_) + suffix_.size() + nfa_.size();
+  }
+
+ private:
+  typedef ByteNFA::Edge Edge;
+
+  ReverseSuffix(const Program* program, const string& suffix);
+
+  // Returns the earliest start of a match ending at `end` and starting at or
+  // after `begin`, or `kInvalidPos`.
+  pos_t FindStart(const char* begin, const char* end, Scratch* scratch) const;
+  // Returns the earliest end of a match in [`begin`, `end`), and sets `*start`
+  // to the earliest start of the matches ending there. Returns `kInvalidPos`
+  // if there is no match.
+  pos_t FindEarliestEnd(pos_t* start, const char* begin, const char* end,
+                        Scratch* scratch) const;
+
+  Literal suffix_;
+  size_t max_match_length_;
+  // Reversed. Its `Step()` is not used, as it is not thread-safe.
+  const ByteNFA nfa_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReverseSuffix);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_REVERSE_SUFFIX_H_
@@ -0,0 +1,28 @@
+#include <algorithm>
+
+#include "scratch.h"
+
+namespace regit {
+namespace internal {
+
+LazyDFA* Scratch::GetLazyDFA(const Program* program, bool reversed) {
+  for (size_t i = 0; i < lazy_dfas_.size(); i++) {
+    if ((lazy_dfas_[i]->program_id() == program->id()) &&
+        (lazy_dfas_[i]->reversed() == reversed)) {
+      if (i != 0) {
+        std::rotate(lazy_dfas_.begin(), lazy_dfas_.begin() + i,
+                    lazy_dfas_.begin() + i + 1);
+      }
+      return lazy_dfas_[0].get();
+    }
+  }
+  if (lazy_dfas_.size() == kMaxLazyDFAs) {
+    lazy_dfas_.pop_back();
+  }
+  lazy_dfas_.insert(lazy_dfas_.begin(),
+                    unique_ptr<LazyDFA>(new LazyDFA(program, reversed)));
+  return lazy_dfas_[0].get();
+}
+
+
+} }  // namespace regit::internal
@@ -0,0 +1,117 @@
+#ifndef REGIT_SCRATCH_H_
+#define REGIT_SCRATCH_H_
+
+#include <memory>
+#include <vector>
+
+#include "globals.h"
+#include "lazy_dfa.h"
+#include "program.h"
+#include "regit.h"
+
+namespace regit {
+namespace internal {
+
+// Memory used by the matching engines while matching.
+// It is kept across matches, so that matching does not allocate any memory
+// once the buffers have grown to the size required. A scratch must only be
+// used by one thread at a time, but can be used with different regexps.
+class Scratch {
+ public:
+  Scratch() {}
+
+  // Returns a buffer of at least `n_positions` positions. The positions are
+  // `kInvalidPos`, and must be left so.
+  pos_t* SimulationData(size_t n_positions) {
+    if (simulation_data_.size() < n_positions) {
+      simulation_data_.resize(n_positions, kInvalidPos);
+    }
+    return simulation_data_.data();
+  }
+  // Returns a buffer of at least `n_states` states. Its content is undefined.
+  uint32_t* SimulationActiveStates(size_t n_states) {
+    if (simulation_active_states_.size() < n_states) {
+      simulation_active_states_.resize(n_states);
+    }
+    return simulation_active_states_.data();
+  }
+
+  // Return buffers of at least `n_words` words and `n_ends` ends for the
+  // `Backtracker`. Their content is undefined.
+  uint64_t* BacktrackerVisited(size_t n_words) {
+    if (backtracker_visited_.size() < n_words) {
+      backtracker_visited_.resize(n_words);
+    }
+    return backtracker_visited_.data();
+  }
+  uint32_t* BacktrackerEnds(size_t n_ends) {
+    if (backtracker_ends_.size() < n_ends) {
+      backtracker_ends_.resize(n_ends);
+    }
+    return backtracker_ends_.data();
+  }
+
+  // Return buffers of at least `n_nodes` nodes and `n_marks` marks for the
+  // `ReverseSuffix` engine. The content of the nodes is undefined. The marks
+  // are zero, and must be left zero.
+  uint32_t* ReverseSuffixNodes(size_t n_nodes) {
+    if (reverse_suffix_nodes_.size() < n_nodes) {
+      reverse_suffix_nodes_.resize(n_nodes);
+    }
+    return reverse_suffix_nodes_.data();
+  }
+  uint8_t* ReverseSuffixMarks(size_t n_marks) {
+    if (reverse_suffix_marks_.size() < n_marks) {
+      reverse_suffix_marks_.resize(n_marks, 0);
+    }
+    return reverse_suffix_marks_.data();
+  }
+
+  // Return buffers of at least `n_nodes` nodes and `n_starts` starts for
+  // `RegitSet`. The content of the nodes is undefined. The starts are
+  // `kInvalidPos`, and must be left so.
+  uint32_t* RegexpSetNodes(size_t n_nodes) {
+    if (regexp_set_nodes_.size() < n_nodes) {
+      regexp_set_nodes_.resize(n_nodes);
+    }
+    return regexp_set_nodes_.data();
+  }
+  pos_t* RegexpSetStarts(size_t n_starts) {
+    if (regexp_set_starts_.size() < n_starts) {
+      regexp_set_starts_.resize(n_starts, kInvalidPos);
+    }
+    return regexp_set_starts_.data();
+  }
+
+  // Returns the lazy DFA for `program`, or for its reversed NFA, creating it if
+  // necessary. The DFAs for the most recently used programs are kept, so that
+  // their cached states are reused across matches.
+  LazyDFA* GetLazyDFA(const Program* program, bool reversed = false);
+
+  // The scratch used when no `MatchContext` is provided.
+  static Scratch* ForCurrentThread() {
+    static thread_local Scratch scratch;
+    return &scratch;
+  }
+
+ private:
+  static constexpr size_t kMaxLazyDFAs = 8;
+
+  vector<pos_t> simulation_data_;
+  vector<uint32_t> simulation_active_states_;
+  vector<uint64_t> backtracker_visited_;
+  vector<uint32_t> backtracker_ends_;
+  vector<uint32_t> reverse_suffix_nodes_;
+  vector<uint8_t> reverse_suffix_marks_;
+  vector<uint32_t> regexp_set_nodes_;
+  vector<pos_t> regexp_set_starts_;
+  // Most recently used first.
+  vector<unique_ptr<LazyDFA>> lazy_dfas_;
+
+  DISALLOW_COPY_AND_ASSIGN(Scratch);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_SCRATCH_H_
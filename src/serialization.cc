@@ -0,0 +1,116 @@
+#include <stdio.h>
+
+#include "program.h"
+#include "regexp_info.h"
+#include "regit.h"
+
+namespace regit {
+
+namespace internal {
+
+// Files written by `Regit::Save()` are laid out as follows:
+//   FileHeader
+//   uint64_t program_offsets[n_programs]
+//   program images, each aligned to `Program::kAlignment`.
+// Offsets are from the start of the file.
+struct FileHeader {
+  static constexpr char kMagic[8] = {'R', 'E', 'G', 'I', 'T', 'B', 'D', 'L'};
+  static constexpr uint32_t kVersion = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order_mark;
+  uint32_t n_programs;
+  uint32_t reserved;
+};
+
+constexpr char FileHeader::kMagic[8];
+
+STATIC_ASSERT(sizeof(FileHeader) % Program::kAlignment == 0);
+
+}  // namespace internal
+
+
+Status Regit::Save(const char* path, const vector<const Regit*>& regexps) {
+  for (const Regit* re : regexps) {
+    re->Compile();
+    if (re->status() != kSuccess) {
+      return re->status();
+    }
+  }
+
+  internal::FileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, internal::FileHeader::kMagic, sizeof(header.magic));
+  header.version = internal::FileHeader::kVersion;
+  header.byte_order_mark = internal::Program::kByteOrderMark;
+  header.n_programs = regexps.size();
+
+  vector<uint64_t> offsets;
+  uint64_t offset = sizeof(header) + regexps.size() * sizeof(uint64_t);
+  for (const Regit* re : regexps) {
+    offsets.push_back(offset);
+    // Program image sizes are multiples of the alignment.
+    offset += re->rinfo_->program()->image_size();
+  }
+
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) {
+    return kIOError;
+  }
+  bool success =
+      (fwrite(&header, sizeof(header), 1, file) == 1) &&
+      (offsets.empty() ||
+       fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) ==
+       offsets.size());
+  for (const Regit* re : regexps) {
+    const internal::Program* program = re->rinfo_->program();
+    success = success &&
+        (fwrite(program->image(), program->image_size(), 1, file) == 1);
+  }
+  success = (fclose(file) == 0) && success;
+  return success ? kSuccess : kIOError;
+}
+
+
+Status Regit::Load(const char* path, vector<unique_ptr<Regit>>* regexps) {
+  shared_ptr<internal::MappedFile> file(new internal::MappedFile());
+  Status status = file->Map(path);
+  if (status != kSuccess) {
+    return status;
+  }
+
+  const char* data = file->data();
+  size_t size = file->size();
+  const internal::FileHeader* header =
+      reinterpret_cast<const internal::FileHeader*>(data);
+  if ((size < sizeof(*header)) ||
+      memcmp(header->magic, internal::FileHeader::kMagic,
+             sizeof(header->magic)) ||
+      (header->version != internal::FileHeader::kVersion) ||
+      (header->byte_order_mark != internal::Program::kByteOrderMark) ||
+      (size - sizeof(*header) < header->n_programs * uint64_t(8))) {
+    return kInvalidFormat;
+  }
+  const uint64_t* offsets =
+      reinterpret_cast<const uint64_t*>(data + sizeof(*header));
+  for (uint32_t i = 0; i < header->n_programs; i++) {
+    if ((offsets[i] >= size) ||
+        !internal::Program::IsValidImage(data + offsets[i],
+                                         size - offsets[i])) {
+      return kInvalidFormat;
+    }
+  }
+
+  for (uint32_t i = 0; i < header->n_programs; i++) {
+    internal::RegexpInfo* rinfo = new internal::RegexpInfo();
+    rinfo->Load(data + offsets[i], file);
+    Regit* re = new Regit(rinfo->program()->regexp());
+    call_once(re->compiled_, [re, rinfo]() { re->rinfo_.reset(rinfo); });
+    regexps->push_back(unique_ptr<Regit>(re));
+  }
+  return kSuccess;
+}
+
+
+}  // namespace regit
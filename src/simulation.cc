@@ -0,0 +1,216 @@
+#include "simulation.h"
+
+
+namespace regit {
+namespace internal {
+
+
+bool Simulation::MatchFull(const char* text, size_t text_size) {
+  if ((prefix_ != nullptr) && !prefix_->IsAt(text, text + text_size)) {
+    return false;
+  }
+  Reset(text, text_size);
+
+  SetState(text, program_->entry_state(), 0);
+
+  while (remaining_text_size() != 0) {
+    Step();
+    if (FLAG_trace_matching) { Print(); }
+    InvalidateTick(0);
+    Advance(1);
+  }
+
+  if (FLAG_trace_matching) { Print(); }
+  return GetState(program_->exit_state(), 0) != kInvalidPos;
+}
+
+
+bool Simulation::MatchAnywhere(Match* match, const char* text, size_t text_size) {
+  Reset(text, text_size);
+
+  pos_t candidate = NextCandidate(current_pos_);
+  while (remaining_text_size() != 0) {
+    if (current_pos_ == candidate) {
+      Seed();
+      candidate = NextCandidate(current_pos_ + 1);
+    } else if (IsIdle()) {
+      if (candidate == kInvalidPos) {
+        break;
+      }
+      SkipTo(candidate);
+      continue;
+    }
+    Step();
+    if (FLAG_trace_matching) { Print(); }
+    InvalidateTick(0);
+    Advance(1);
+    pos_t found_pos = GetState(program_->exit_state(), 0);
+    if (found_pos != kInvalidPos) {
+      match->start = found_pos;
+      match->end = current_pos_;
+      return true;
+    }
+  }
+
+  if (FLAG_trace_matching) { Print(); }
+  return false;
+}
+
+
+bool Simulation::MatchFirst(Match* match, const char* text, size_t text_size) {
+  Reset(text, text_size);
+
+  bool found_match = false;
+
+  pos_t candidate = NextCandidate(current_pos_);
+  while (remaining_text_size() != 0) {
+    if (!found_match && (current_pos_ == candidate)) {
+      Seed();
+      candidate = NextCandidate(current_pos_ + 1);
+    } else if (IsIdle()) {
+      // Once a match has been found, no later match can be preferable.
+      if (found_match || (candidate == kInvalidPos)) {
+        break;
+      }
+      SkipTo(candidate);
+      continue;
+    }
+    Step();
+    if (FLAG_trace_matching) { Print(); }
+    InvalidateTick(0);
+    Advance(1);
+    pos_t found_pos = GetState(program_->exit_state(), 0);
+    if (found_pos != kInvalidPos) {
+      // Any newly found match must be preferable to the previously found match.
+      // Its start is not necessarily before the previous match's start, but
+      // it is never after the start of the first match found, since states
+      // set after that have been invalidated.
+      ASSERT(!found_match || (current_pos_ >= match->end));
+      if (!found_match) {
+        InvalidateStatesAfter(found_pos);
+      }
+      found_match = true;
+      match->start = found_pos;
+      match->end = current_pos_;
+    }
+  }
+
+  if (FLAG_trace_matching) { Print(); }
+  return found_match;
+}
+
+
+bool Simulation::MatchAll(vector<Match>* matches, const char* text, size_t text_size) {
+  bool found_match;
+  bool has_matched = false;
+  Match match;
+  do {
+    found_match = MatchFirst(&match, text, text_size);
+    if (found_match) {
+      matches->push_back(match);
+      has_matched = true;
+      text_size -= (match.end - text);
+      text = match.end;
+    }
+  } while (found_match && (text_size != 0));
+  return has_matched;
+}
+
+
+void Simulation::InvalidateStatesAfter(pos_t start) {
+  for (int tick = 0; tick < n_ticks_; tick++) {
+    uint32_t* active = ActiveStates(tick);
+    pos_t* positions = StatePointer(0, tick);
+    uint32_t n_active = 0;
+    for (uint32_t i = 1; i <= active[0]; i++) {
+      if (positions[active[i]] > start) {
+        positions[active[i]] = kInvalidPos;
+      } else {
+        active[++n_active] = active[i];
+      }
+    }
+    active[0] = n_active;
+  }
+}
+
+
+pos_t Simulation::EarliestActivePosition() const {
+  pos_t earliest = current_pos_;
+  for (int tick = 0; tick < n_ticks_; tick++) {
+    const uint32_t* active = ActiveStates(tick);
+    const pos_t* positions = StatePointer(0, tick);
+    for (uint32_t i = 1; i <= active[0]; i++) {
+      earliest = min(earliest, positions[active[i]]);
+    }
+  }
+  return earliest;
+}
+
+
+void Simulation::Relocate(pos_t from, pos_t to) {
+  ASSERT(EarliestActivePosition() >= from);
+  for (int tick = 0; tick < n_ticks_; tick++) {
+    const uint32_t* active = ActiveStates(tick);
+    pos_t* positions = StatePointer(0, tick);
+    for (uint32_t i = 1; i <= active[0]; i++) {
+      positions[active[i]] = to + (positions[active[i]] - from);
+    }
+  }
+  text_ = to + (max(text_, from) - from);
+  // Once idle, the exact idle position does not matter.
+  idle_pos_ = to + (max(idle_pos_, current_pos_) - from);
+  current_pos_ = to + (current_pos_ - from);
+}
+
+
+void Simulation::Print(int tick) const {
+#define ACTIVE_STYLE_INITIAL    "style=bold,color=blue"
+#define ACTIVE_STYLE_TRANSITION "style=bold,color=orange"
+#define ACTIVE_STYLE_FUTURE     ACTIVE_STYLE_TRANSITION
+#define INACTIVE_STYLE          "style=\"\",color=\"\""
+
+  int current_offset = CurrentOffset();
+  cout << "digraph trace_" << current_offset << "_" << tick << " {\n"
+      << "  label=\"offset " << current_offset << " tick " << tick << "\\n"
+      <<            "text: " << current_pos_ + tick << "\";\n"
+      << "  labelloc=t;\n"
+      << "  rankdir=\"LR\";  // We prefer an horizontal graph.\n";
+  program_->PrintInfo();
+
+  for (int state = 0; state < n_states_; state++) {
+    pos_t pos = GetState(state, tick);
+    if (pos != kInvalidPos) {
+      cout << "  node [label=\"" <<  pos - text_ << "\",";
+      if (tick == 0) {
+        cout << ACTIVE_STYLE_INITIAL "]; ";
+      } else {
+        cout << ACTIVE_STYLE_FUTURE "]; ";
+      }
+    } else {
+      cout << "  node [label=\"\"," << INACTIVE_STYLE "]; ";
+    }
+    cout << state << ";\n";
+  }
+  cout << "  // Transitions.\n";
+  cout << "  node [" INACTIVE_STYLE "];\n";
+  for (int state = 0; state < n_states_; state++) {
+    bool active_state = GetState(state, tick) != kInvalidPos;
+    for (const Program::Transition* transition =
+             program_->transitions_begin(state);
+         transition < program_->transitions_end(state);
+         transition++) {
+      cout << "  " << state << " -> " << transition->exit << " [label=\"";
+      program_->PrintTransition(transition);
+      cout << "\"";
+      if (active_state && (tick == 0) &&
+          (-1 != program_->Match(transition, current_pos_, text_end_))) {
+        cout << "," ACTIVE_STYLE_TRANSITION;
+      }
+      cout << "];\n";
+    }
+  }
+  cout << "}\n";
+}
+
+
+} }  // namespace regit::internal
@@ -0,0 +1,229 @@
+#ifndef REGIT_SIMULATION_H_
+#define REGIT_SIMULATION_H_
+
+#include "program.h"
+#include "regit.h"
+#include "scratch.h"
+
+namespace regit {
+namespace internal {
+
+// Simulates the program on the text, tracking for each active state the
+// earliest position where a match reaching it started.
+//
+// A transition matching n characters activates its exit state n ticks later,
+// so the states of the next `max_transition_match_length()` positions are kept
+// in a ring of ticks. Each tick has the positions of all the states, and the
+// list of its active states. Stepping and invalidating only visit the active
+// states, so their cost does not depend on the size of the program.
+class Simulation {
+ public:
+  Simulation(const Program* program, Scratch* scratch)
+      : program_(program),
+        n_states_(program->n_states()),
+        n_ticks_(program->max_transition_match_length() + 1),
+        prefix_(FLAG_use_literal_search ? program->prefix() : nullptr),
+        current_tick_(0),
+        current_pos_(kInvalidPos),
+        data_(scratch->SimulationData(n_ticks_ * n_states_)),
+        active_(scratch->SimulationActiveStates(
+            n_ticks_ * (n_states_ + 1))) {
+    // The positions in `data_` are invalid, so no state is active.
+    for (int tick = 0; tick < n_ticks_; tick++) {
+      *ActiveStates(tick) = 0;
+    }
+  }
+  // Leave the positions in the scratch invalid for the next simulation.
+  ~Simulation() { InvalidateTicks(); }
+
+  bool MatchFull(const char* text, size_t text_size);
+  bool MatchAnywhere(Match* match, const char* text, size_t text_size);
+  bool MatchFirst(Match* match, const char* text, size_t text_size);
+  bool MatchAll(vector<Match>* matches, const char* text, size_t text_size);
+
+  // Prepare to match `text`, with no active states.
+  void Reset(const char* text, size_t text_size) {
+    InvalidateTicks();
+    text_ = text;
+    text_end_ = text + text_size;
+    current_pos_ = text_;
+    current_tick_ = 0;
+    idle_pos_ = text_;
+  }
+
+  size_t ComputeTickSize() const {
+    return n_states_ * sizeof(pos_t);
+  }
+  size_t ComputeDataSize() const {
+    return n_ticks_ * ComputeTickSize();
+  }
+
+  pos_t GetState(int state, int tick) const {
+    return *StatePointer(state, tick);
+  }
+
+  // Activate `state` with the valid position `pos`.
+  void SetState(pos_t pos, int state, int tick) const {
+    ASSERT(pos != kInvalidPos);
+    pos_t* state_pointer = StatePointer(state, tick);
+    if (*state_pointer == kInvalidPos) {
+      AddActiveState(state, tick);
+    }
+    *state_pointer = pos;
+  }
+
+  // Activate `state` with `pos`, unless it is active with an earlier position.
+  void UpdateState(pos_t pos, int state, int tick) const {
+    pos_t* state_pointer = StatePointer(state, tick);
+    if (*state_pointer == kInvalidPos) {
+      AddActiveState(state, tick);
+      *state_pointer = pos;
+    } else {
+      *state_pointer = min(*state_pointer, pos);
+    }
+  }
+
+  void InvalidateTick(int tick) const {
+    STATIC_ASSERT(kInvalidPos == nullptr);
+    uint32_t* active = ActiveStates(tick);
+    pos_t* positions = StatePointer(0, tick);
+    for (uint32_t i = 1; i <= active[0]; i++) {
+      positions[active[i]] = kInvalidPos;
+    }
+    active[0] = 0;
+  }
+  void InvalidateTicks() const {
+    for (int tick = 0; tick < n_ticks_; tick++) {
+      InvalidateTick(tick);
+    }
+  }
+
+  // Process the transitions from all the states active at the current tick.
+  void Step() const {
+    const pos_t* current = StatePointer(0, 0);
+    const uint32_t* active = ActiveStates(0);
+    // Transitions match at least one character, so they do not activate
+    // states at the current tick.
+    for (uint32_t i = 1; i <= active[0]; i++) {
+      int state = active[i];
+      pos_t state_pos = current[state];
+      const Program::Transition* end = program_->transitions_end(state);
+      for (const Program::Transition* transition =
+               program_->transitions_begin(state);
+           transition < end;
+           transition++) {
+        int chars_matched =
+            program_->Match(transition, current_pos_, text_end_);
+        if (chars_matched != -1) {
+          UpdateState(state_pos, transition->exit, chars_matched);
+        }
+      }
+    }
+  }
+
+  void Advance(int ticks) {
+    ASSERT(ticks < n_ticks_);
+    current_tick_ += ticks;
+    if (current_tick_ >= n_ticks_) {
+      current_tick_ -= n_ticks_;
+    }
+    ASSERT(remaining_text_size() > 0);
+    ASSERT(current_pos_ < text_end_);
+    current_pos_++;
+  }
+
+  // Activate the entry state at the current position. No state remains active
+  // once the longest match from this position has been passed.
+  void Seed() {
+    SetState(current_pos_, program_->entry_state(), 0);
+    idle_pos_ = current_pos_ +
+        min(program_->max_match_length() + 1, remaining_text_size());
+  }
+  // True when no state is active.
+  bool IsIdle() const { return current_pos_ >= idle_pos_; }
+  // The next position at or after `pos` where a match can start, or
+  // `kInvalidPos`. Without a prefix, matches can start anywhere.
+  pos_t NextCandidate(pos_t pos) const {
+    return (prefix_ != nullptr) ? prefix_->Find(pos, text_end_) : pos;
+  }
+  // Move to `pos` without processing the text up to it. No state must be
+  // active.
+  void SkipTo(pos_t pos) {
+    ASSERT(IsIdle());
+    ASSERT((current_pos_ <= pos) && (pos < text_end_));
+    current_pos_ = pos;
+    idle_pos_ = pos;
+  }
+
+  // Invalidate states set after start (excluded).
+  void InvalidateStatesAfter(pos_t start);
+
+  // When streaming, the text is held in a buffer that is compacted as it is
+  // consumed, and extended as chunks arrive.
+  // The earliest position of the active states, or the current position if
+  // none is earlier.
+  pos_t EarliestActivePosition() const;
+  // The text from `from` on moved to `to`. The positions of the active states
+  // must not be before `from`.
+  void Relocate(pos_t from, pos_t to);
+  void SetTextEnd(pos_t text_end) { text_end_ = text_end; }
+
+  pos_t current_pos() const { return current_pos_; }
+  int Offset(pos_t pos) const { return pos - text_; }
+  int CurrentOffset() const { return Offset(current_pos_); }
+  void Print(int tick) const;
+  void Print() const {
+    for (int i = 0;
+         i < n_ticks_ && static_cast<size_t>(i) <= remaining_text_size();
+         i++) {
+      Print(i);
+    }
+    cout << "// End of offset\n";
+  }
+
+  size_t remaining_text_size() const { return text_end_ - current_pos_; }
+
+ private:
+  int TickIndex(int tick) const {
+    ASSERT(tick < n_ticks_);
+    int t = current_tick_ + tick;
+    if (t >= n_ticks_) {
+      t -= n_ticks_;
+    }
+    return t;
+  }
+  pos_t* StatePointer(int state_index, int tick) const {
+    return data_ + TickIndex(tick) * n_states_ + state_index;
+  }
+  // The number of states active at the tick, followed by the states.
+  uint32_t* ActiveStates(int tick) const {
+    return active_ + TickIndex(tick) * (n_states_ + 1);
+  }
+  void AddActiveState(int state, int tick) const {
+    uint32_t* active = ActiveStates(tick);
+    active[++active[0]] = state;
+  }
+
+  const Program* program_;
+  const int n_states_;
+  const int n_ticks_;
+  const Literal* prefix_;
+
+  int current_tick_;
+  pos_t text_;
+  pos_t text_end_;
+  pos_t current_pos_;
+  // No state is active at or after this position, unless the entry state is
+  // activated again.
+  pos_t idle_pos_;
+
+  pos_t* data_;
+  uint32_t* active_;
+
+  DISALLOW_COPY_AND_ASSIGN(Simulation);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_SIMULATION_H_
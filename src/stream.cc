@@ -0,0 +1,175 @@
+#include <string.h>
+
+#include "stream.h"
+
+namespace regit {
+namespace internal {
+
+constexpr size_t Stream::kBlockSize;
+
+
+Stream::Stream(const Program* program)
+    : program_(program),
+      prefix_(FLAG_use_literal_search ? program->prefix() : nullptr),
+      lookahead_(max(static_cast<size_t>(
+                         program->max_transition_match_length()),
+                     (prefix_ != nullptr) ? prefix_->size() : 0)),
+      window_(program->max_match_length() + lookahead_ + 1),
+      buffer_(window_ + kBlockSize + program->max_match_length() + 1),
+      buffer_limit_(buffer_.data() + window_ + kBlockSize),
+      simulation_(program, &scratch_) {
+  fill(can_start_, can_start_ + 256, false);
+  const uint32_t entry_state = program->entry_state();
+  for (const Program::Transition* transition =
+           program->transitions_begin(entry_state);
+       transition < program->transitions_end(entry_state);
+       transition++) {
+    for (int byte = 0; byte < 256; byte++) {
+      char c = static_cast<char>(byte);
+      can_start_[byte] |= (transition->kind == Program::kPeriodTransition)
+          ? (program->MatchPeriod(transition, &c) != -1)
+          : (c == transition->first_char);
+    }
+  }
+  Reset();
+}
+
+
+void Stream::Reset() {
+  data_end_ = buffer_.data();
+  offset_ = 0;
+  finishing_ = false;
+  found_match_ = false;
+  Restart(buffer_.data());
+}
+
+
+bool Stream::Feed(vector<StreamMatch>* matches,
+                  const char* chunk, size_t chunk_size) {
+  ASSERT(!finishing_);
+  size_t n_matches = matches->size();
+  while (chunk_size != 0) {
+    size_t n_copied =
+        min(chunk_size, static_cast<size_t>(buffer_limit_ - data_end_));
+    memcpy(data_end_, chunk, n_copied);
+    data_end_ += n_copied;
+    chunk += n_copied;
+    chunk_size -= n_copied;
+    Match(matches);
+    Compact();
+  }
+  return matches->size() > n_matches;
+}
+
+
+bool Stream::Finish(vector<StreamMatch>* matches) {
+  size_t n_matches = matches->size();
+  finishing_ = true;
+  simulation_.SetTextEnd(data_end_);
+  if (!found_match_) {
+    candidate_ = NextCandidate(candidate_);
+  }
+  Match(matches);
+  Reset();
+  return matches->size() > n_matches;
+}
+
+
+void Stream::Match(vector<StreamMatch>* matches) {
+  // Positions before `end` have their `lookahead_` bytes buffered.
+  size_t data_size = data_end_ - buffer_.data();
+  pos_t end = finishing_ ? data_end_
+                         : buffer_.data() +
+                               ((data_size >= lookahead_ - 1)
+                                    ? data_size - (lookahead_ - 1) : 0);
+  // Like `Simulation::MatchAll()`, without restarting from the text.
+  while (true) {
+    pos_t pos = simulation_.current_pos();
+    if (found_match_ &&
+        (simulation_.IsIdle() || (finishing_ && (pos >= end)))) {
+      // No later match can be preferable to the found one.
+      ReportMatch(matches);
+      continue;
+    }
+    if (pos >= end) {
+      break;
+    }
+    if (!found_match_ && (pos == candidate_)) {
+      simulation_.Seed();
+      candidate_ = NextCandidate(pos + 1);
+    } else if (simulation_.IsIdle()) {
+      if (candidate_ == kInvalidPos) {
+        break;
+      }
+      simulation_.SkipTo(candidate_);
+      continue;
+    }
+    simulation_.Step();
+    if (FLAG_trace_matching) { simulation_.Print(); }
+    simulation_.InvalidateTick(0);
+    simulation_.Advance(1);
+    pos_t found_pos = simulation_.GetState(program_->exit_state(), 0);
+    if (found_pos != kInvalidPos) {
+      if (!found_match_) {
+        simulation_.InvalidateStatesAfter(found_pos);
+      }
+      found_match_ = true;
+      match_.start = Offset(found_pos);
+      match_.end = Offset(simulation_.current_pos());
+    }
+  }
+}
+
+
+void Stream::ReportMatch(vector<StreamMatch>* matches) {
+  matches->push_back(match_);
+  found_match_ = false;
+  Restart(Position(match_.end));
+}
+
+
+void Stream::Restart(pos_t pos) {
+  pos_t text_end = finishing_ ? data_end_ : buffer_.data() + buffer_.size();
+  simulation_.Reset(pos, text_end - pos);
+  candidate_ = NextCandidate(pos);
+}
+
+
+void Stream::Compact() {
+  pos_t keep = simulation_.EarliestActivePosition();
+  if (found_match_) {
+    keep = min(keep, Position(match_.end));
+  }
+  size_t n_dropped = keep - buffer_.data();
+  if (n_dropped == 0) {
+    return;
+  }
+  memmove(buffer_.data(), keep, data_end_ - keep);
+  simulation_.Relocate(keep, buffer_.data());
+  // The candidate is only used again once the found match is reported.
+  candidate_ = found_match_ ? kInvalidPos
+                            : buffer_.data() + (candidate_ - keep);
+  data_end_ -= n_dropped;
+  offset_ += n_dropped;
+  ASSERT(static_cast<size_t>(data_end_ - buffer_.data()) <= window_);
+}
+
+
+pos_t Stream::NextCandidate(pos_t pos) const {
+  if (prefix_ == nullptr) {
+    while ((pos < data_end_) && !can_start_[static_cast<uint8_t>(*pos)]) {
+      pos++;
+    }
+    return ((pos < data_end_) || !finishing_) ? pos : kInvalidPos;
+  }
+  pos_t found = prefix_->Find(pos, data_end_);
+  if ((found != kInvalidPos) || finishing_) {
+    return found;
+  }
+  size_t prefix_size = prefix_->size();
+  return (static_cast<size_t>(data_end_ - pos) < prefix_size)
+      ? pos : data_end_ - (prefix_size - 1);
+}
+
+
+} }  // namespace regit::internal
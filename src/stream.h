@@ -0,0 +1,95 @@
+#ifndef REGIT_STREAM_H_
+#define REGIT_STREAM_H_
+
+#include <vector>
+
+#include "globals.h"
+#include "literal.h"
+#include "program.h"
+#include "regit.h"
+#include "scratch.h"
+#include "simulation.h"
+
+namespace regit {
+namespace internal {
+
+// Matches a program on a text received in chunks (see `RegitStream`).
+//
+// The chunks are copied into a buffer of fixed size, and the simulation steps
+// through it like through a whole text, its tick ring carrying the state from
+// one chunk to the next. A position is only processed once the `lookahead_`
+// bytes following it are buffered, so that transitions matching multiple
+// characters, and the prefix, can be checked across chunk boundaries. While no
+// state is active, the positions where no match can start are skipped.
+// Matches are at most `max_match_length()` long, so only the last bytes of the
+// buffer are needed once it has been processed: the buffer is then compacted,
+// and the positions of the simulation relocated.
+class Stream {
+ public:
+  explicit Stream(const Program* program);
+
+  // Append to `matches` the matches made final by the chunk. Returns true if
+  // any was.
+  bool Feed(vector<StreamMatch>* matches, const char* chunk, size_t chunk_size);
+  // Append to `matches` the matches left at the end of the text, and reset
+  // the stream. Returns true if any was.
+  bool Finish(vector<StreamMatch>* matches);
+
+  // Prepare to match a new text.
+  void Reset();
+
+ private:
+  // The number of bytes copied into the buffer at most before processing it.
+  static constexpr size_t kBlockSize = 64 * 1024;
+
+  // Process the buffered text, up to the end of the text when finishing.
+  void Match(vector<StreamMatch>* matches);
+  // Report the found match, and restart matching from its end.
+  void ReportMatch(vector<StreamMatch>* matches);
+  void Restart(pos_t pos);
+  // Drop the buffered bytes that can no longer be part of a match.
+  void Compact();
+
+  // The next position at or after `pos` where a match can start. Until the
+  // stream is finishing, this can be a position in the last bytes of the
+  // buffer, where a match may start once more bytes are buffered.
+  pos_t NextCandidate(pos_t pos) const;
+
+  uint64_t Offset(pos_t pos) const { return offset_ + (pos - buffer_.data()); }
+  pos_t Position(uint64_t offset) const {
+    return buffer_.data() + (offset - offset_);
+  }
+
+  const Program* program_;
+  const Literal* prefix_;
+  // Without a prefix, whether matches can start with each byte.
+  bool can_start_[256];
+  // The number of bytes needed from a position to process it.
+  const size_t lookahead_;
+  // The maximum number of bytes kept in the buffer after compaction.
+  const size_t window_;
+
+  vector<char> buffer_;
+  // The buffered bytes end at `data_end_`, never past `buffer_limit_`. The
+  // rest of the buffer leaves room for the simulation to look beyond the data
+  // before it is finishing.
+  char* data_end_;
+  const char* buffer_limit_;
+  // The offset in the stream of the start of the buffer.
+  uint64_t offset_;
+  bool finishing_;
+
+  pos_t candidate_;
+  bool found_match_;
+  StreamMatch match_;
+
+  Scratch scratch_;
+  Simulation simulation_;
+
+  DISALLOW_COPY_AND_ASSIGN(Stream);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_STREAM_H_
@@ -0,0 +1,168 @@
+#include "teddy.h"
+
+#include <string.h>
+
+#ifdef REGIT_TEDDY_SSSE3
+#include <tmmintrin.h>
+#endif
+
+namespace regit {
+namespace internal {
+
+constexpr size_t Teddy::kMinLiterals;
+constexpr size_t Teddy::kMaxLiterals;
+constexpr size_t Teddy::kNBuckets;
+constexpr size_t Teddy::kMaxPrefixSize;
+
+
+Teddy* Teddy::Build(const vector<string>& literals) {
+#ifdef REGIT_TEDDY_SSSE3
+  if (!__builtin_cpu_supports("ssse3")) {
+    return nullptr;
+  }
+#else
+  return nullptr;
+#endif
+  if ((literals.size() < kMinLiterals) || (literals.size() > kMaxLiterals)) {
+    return nullptr;
+  }
+  for (const string& literal : literals) {
+    if (literal.empty()) {
+      return nullptr;
+    }
+  }
+  return new Teddy(literals);
+}
+
+
+Teddy::Teddy(const vector<string>& literals) : prefix_size_(kMaxPrefixSize) {
+  for (const string& literal : literals) {
+    prefix_size_ = min(prefix_size_, literal.size());
+  }
+  memset(low_masks_, 0, sizeof(low_masks_));
+  memset(high_masks_, 0, sizeof(high_masks_));
+  // The literals are expected sorted, so that consecutive literals, which go
+  // to the same bucket, often share their prefix. Fewer buckets then match the
+  // prefix of a literal from another bucket.
+  for (size_t i = 0; i < literals.size(); i++) {
+    const string& literal = literals[i];
+    size_t bucket = i * kNBuckets / literals.size();
+    buckets_[bucket].push_back(literal);
+    for (size_t offset = 0; offset < prefix_size_; offset++) {
+      uint8_t byte = static_cast<uint8_t>(literal[offset]);
+      low_masks_[offset][byte & 0xf] |= 1 << bucket;
+      high_masks_[offset][byte >> 4] |= 1 << bucket;
+    }
+  }
+}
+
+
+bool Teddy::Confirm(uint8_t buckets, const char* pos, const char* end) const {
+  for (size_t bucket = 0; bucket < kNBuckets; bucket++) {
+    if ((buckets & (1 << bucket)) == 0) {
+      continue;
+    }
+    for (const string& literal : buckets_[bucket]) {
+      if ((literal.size() <= static_cast<size_t>(end - pos)) &&
+          !memcmp(pos, literal.data(), literal.size())) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+
+pos_t Teddy::FindScalar(const char* begin, const char* end) const {
+  for (const char* pos = begin;
+       static_cast<size_t>(end - pos) >= prefix_size_;
+       pos++) {
+    uint8_t buckets = 0xff;
+    for (size_t offset = 0; offset < prefix_size_; offset++) {
+      uint8_t byte = static_cast<uint8_t>(pos[offset]);
+      buckets &=
+          low_masks_[offset][byte & 0xf] & high_masks_[offset][byte >> 4];
+    }
+    if ((buckets != 0) && Confirm(buckets, pos, end)) {
+      return pos;
+    }
+  }
+  return kInvalidPos;
+}
+
+
+#ifdef REGIT_TEDDY_SSSE3
+
+pos_t Teddy::ConfirmBlock(unsigned candidates, const uint8_t* lanes,
+                          const char* block, const char* end) const {
+  for (; candidates != 0; candidates &= candidates - 1) {
+    int lane = __builtin_ctz(candidates);
+    if (Confirm(lanes[lane], block + lane, end)) {
+      return block + lane;
+    }
+  }
+  return kInvalidPos;
+}
+
+
+template <int kPrefixSize>
+__attribute__((target("ssse3")))
+pos_t Teddy::FindSSSE3(const char* begin, const char* end) const {
+  const __m128i nibble_mask = _mm_set1_epi8(0xf);
+  __m128i low_masks[kPrefixSize];
+  __m128i high_masks[kPrefixSize];
+  for (int offset = 0; offset < kPrefixSize; offset++) {
+    low_masks[offset] = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(low_masks_[offset]));
+    high_masks[offset] = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(high_masks_[offset]));
+  }
+  // The blocks of 16 positions are read at each offset of the prefix.
+  const char* pos = begin;
+  for (; end - pos >= 16 + kPrefixSize - 1; pos += 16) {
+    __m128i buckets = _mm_set1_epi8(-1);
+    for (int offset = 0; offset < kPrefixSize; offset++) {
+      __m128i bytes =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + offset));
+      __m128i low = _mm_and_si128(bytes, nibble_mask);
+      __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble_mask);
+      buckets = _mm_and_si128(
+          buckets,
+          _mm_and_si128(_mm_shuffle_epi8(low_masks[offset], low),
+                        _mm_shuffle_epi8(high_masks[offset], high)));
+    }
+    unsigned candidates = ~_mm_movemask_epi8(
+        _mm_cmpeq_epi8(buckets, _mm_setzero_si128())) & 0xffff;
+    if (candidates != 0) {
+      uint8_t lanes[16];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), buckets);
+      pos_t found = ConfirmBlock(candidates, lanes, pos, end);
+      if (found != kInvalidPos) {
+        return found;
+      }
+    }
+  }
+  return FindScalar(pos, end);
+}
+
+#endif  // REGIT_TEDDY_SSSE3
+
+
+pos_t Teddy::Find(const char* begin, const char* end) const {
+#ifdef REGIT_TEDDY_SSSE3
+  switch (prefix_size_) {
+    case 1:
+      return FindSSSE3<1>(begin, end);
+    case 2:
+      return FindSSSE3<2>(begin, end);
+    case 3:
+      return FindSSSE3<3>(begin, end);
+    default:
+      UNREACHABLE();
+  }
+#endif
+  return FindScalar(begin, end);
+}
+
+
+} }  // namespace regit::internal
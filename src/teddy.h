@@ -0,0 +1,84 @@
+#ifndef REGIT_TEDDY_H_
+#define REGIT_TEDDY_H_
+
+#include <string>
+#include <vector>
+
+#include "globals.h"
+#include "regit.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define REGIT_TEDDY_SSSE3
+#endif
+
+namespace regit {
+namespace internal {
+
+// Searches for a small set of literals at once, with SSSE3 byte shuffles, in
+// the style of the Teddy algorithm.
+//
+// The literals are spread across 8 buckets. For each of the first
+// `prefix_size_` bytes of the literals, two tables indexed by the low and high
+// nibbles of a byte give the buckets with literals having a byte with this
+// nibble at this offset. A shuffle looks up 16 bytes of text in a table at
+// once, so 16 positions are checked for all the literals with a few shuffles
+// and ands. The rare positions where the prefix of a literal may start are
+// candidates, confirmed by comparing the literals of their buckets.
+//
+// Texts shorter than a block are searched with the same tables one byte at a
+// time.
+class Teddy {
+ public:
+  static constexpr size_t kMinLiterals = 2;
+  static constexpr size_t kMaxLiterals = 64;
+  static constexpr size_t kNBuckets = 8;
+  static constexpr size_t kMaxPrefixSize = 3;
+
+  // Returns nullptr if there are too few or too many literals, if one is
+  // empty, or if the processor does not support SSSE3.
+  static Teddy* Build(const vector<string>& literals);
+
+  // Returns the start of the first occurrence of any of the literals in
+  // [`begin`, `end`), or `kInvalidPos`.
+  pos_t Find(const char* begin, const char* end) const;
+
+  // The memory used, in bytes.
+  size_t size() const {
+    size_t size = sizeof(*this);
+    for (const vector<string>& bucket : buckets_) {
+      for (const string& literal : bucket) {
+        size += sizeof(literal) + literal.size();
+      }
+    }
+    return size;
+  }
+
+ private:
+  explicit Teddy(const vector<string>& literals);
+
+  // True if a literal from one of the `buckets` starts at `pos`.
+  bool Confirm(uint8_t buckets, const char* pos, const char* end) const;
+  pos_t FindScalar(const char* begin, const char* end) const;
+#ifdef REGIT_TEDDY_SSSE3
+  // Confirm the `candidates` lanes of the block of 16 positions at `block`, in
+  // order, with the buckets in `lanes`. Kept out of line, so that the search
+  // loop does not have to spill its registers around the call.
+  __attribute__((noinline))
+  pos_t ConfirmBlock(unsigned candidates, const uint8_t* lanes,
+                     const char* block, const char* end) const;
+  template <int kPrefixSize>
+  pos_t FindSSSE3(const char* begin, const char* end) const;
+#endif
+
+  size_t prefix_size_;
+  uint8_t low_masks_[kMaxPrefixSize][16];
+  uint8_t high_masks_[kMaxPrefixSize][16];
+  vector<string> buckets_[kNBuckets];
+
+  DISALLOW_COPY_AND_ASSIGN(Teddy);
+};
+
+
+} }  // namespace regit::internal
+
+#endif  // REGIT_TEDDY_H_
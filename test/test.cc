@@ -1,11 +1,19 @@
+#include <algorithm>
+#include <atomic>
 #include <initializer_list>
+#include <thread>
 
 #include <argp.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "checks.h"
 #include "globals.h"
 #include "regit.h"
+#if __cplusplus >= 202002L
+#include "regit_static.h"
+#endif
 
 
 // Start the enum from the latest argp key used.
@@ -28,6 +36,10 @@ struct argp_option options[] =
     "Break when a test fails.", 0},
   {"verbose", 'v', nullptr, OPTION_ARG_OPTIONAL,
     "Print the line and test-id of the tests run.", 0},
+  {"max_dfa_states", 'd', "0", OPTION_ARG_OPTIONAL,
+    "Compile the regexps with this DFA states budget. (Or 0 for no DFA.)", 0},
+  {"jit", 'j', "0", OPTION_ARG_OPTIONAL,
+    "Compile the regexps with the JIT.", 0},
   // Convenient access to regit flags.
 #define FLAG_OPTION(flag_name, r, d, desc)                                     \
   {#flag_name, flag_name##_key,                                                \
@@ -51,6 +63,8 @@ struct arguments {
   int test_id;
   bool break_on_fail;
   bool verbose;
+  unsigned max_dfa_states;
+  bool jit;
 };
 struct arguments arguments;
 
@@ -74,6 +88,14 @@ error_t parse_opt(int key, char *arg, struct argp_state *state) {
     case 'v':
       arguments->verbose = true;
       break;
+    case 'd':
+      if (arg) {
+        arguments->max_dfa_states = stol(arg);
+      }
+      break;
+    case 'j':
+      arguments->jit = (arg == nullptr) || (stol(arg) != 0);
+      break;
 #define FLAG_CASE(flag_name, r, d, desc)                                       \
     case flag_name##_key: {                                                    \
       unsigned v = (arg == nullptr) ? 1 : stol(arg);                           \
@@ -134,13 +156,41 @@ class TestCounters {
 };
 
 
+// The match functions of a `Static` regexp.
+struct StaticMatcher {
+  bool (*match_full)(const char* text, size_t text_size);
+  bool (*match_anywhere)(Match* match, const char* text, size_t text_size);
+  bool (*match_first)(Match* match, const char* text, size_t text_size);
+  bool (*match_all)(vector<Match>* matches,
+                    const char* text, size_t text_size);
+};
+
+#if __cplusplus >= 202002L
+template <typename StaticRegexp>
+static const StaticMatcher* GetStaticMatcher() {
+  static const StaticMatcher matcher = {
+    &StaticRegexp::MatchFull, &StaticRegexp::MatchAnywhere,
+    &StaticRegexp::MatchFirst, &StaticRegexp::MatchAll
+  };
+  return &matcher;
+}
+#endif
+
+
 class TestContext {
  public:
   TestContext(const struct arguments* arguments)
-      : arguments_(arguments), test_id_(0) {}
+      : arguments_(arguments), test_id_(0),
+        options_(false, arguments->max_dfa_states, arguments->jit),
+        static_matcher_(nullptr) {}
   const struct arguments* arguments_;
   int test_id_;
   TestCounters test_counters_;
+  // The options used to compile the tested regexps.
+  Options options_;
+  // When set, the tests match with this `Static` regexp instead of compiling
+  // the regexp with `Regit`.
+  const StaticMatcher* static_matcher_;
 };
 
 
@@ -172,6 +222,29 @@ static void DoTestAll(
     const char* regexp, const string& text,
     unsigned expected, const std::vector<MatchOffsets>& expected_matches,
     bool only_check_specified_matches = false);
+static void DoTestShared(
+    TestContext* context, unsigned line,
+    const char* regexp, const string& text,
+    const std::vector<MatchOffsets>& expected_matches);
+static void DoTestCache(
+    TestContext* context, unsigned line,
+    const char* regexp, const string& text,
+    bool expected);
+static void DoTestSaved(
+    TestContext* context, unsigned line,
+    const char* regexp, const string& text,
+    const std::vector<MatchOffsets>& expected_matches);
+static void DoTestCorrupted(
+    TestContext* context, unsigned line,
+    const char* regexp, const string& text);
+static void DoTestSet(
+    TestContext* context, unsigned line,
+    const std::vector<const char*>& regexps, const string& text,
+    const std::vector<size_t>& expected_ids);
+static void DoTestStream(
+    TestContext* context, unsigned line,
+    const char* regexp, const string& text,
+    const std::vector<MatchOffsets>& expected_matches);
 
 static void TestFull(
     TestContext* context, unsigned line,
@@ -193,24 +266,62 @@ static void TestAll(
 int RunTests(const struct arguments *arguments) {
   TestContext context(arguments);
 
+  // In C++20 builds, the tests of the match types are run a second time with
+  // `regit::Static<re>`.
+#if __cplusplus >= 202002L
+#define STATIC_TEST(re, test)                                                  \
+  context.static_matcher_ = GetStaticMatcher<Static<re>>();                    \
+  test;                                                                        \
+  context.static_matcher_ = nullptr;
+#else
+#define STATIC_TEST(re, test)
+#endif
+
 #define TEST_Full(expected, re, text)                                          \
-  TestFull(&context, __LINE__, re, string(text), expected);
+  TestFull(&context, __LINE__, re, string(text), expected);                    \
+  STATIC_TEST(re, TestFull(&context, __LINE__, re, string(text), expected))
 
 #define TEST_First(expected, re, text, ...)                                    \
-  TestFirst(&context, __LINE__, re, string(text), expected, __VA_ARGS__);
+  TestFirst(&context, __LINE__, re, string(text), expected, __VA_ARGS__);      \
+  STATIC_TEST(re, TestFirst(&context, __LINE__, re, string(text), expected,    \
+                            __VA_ARGS__))
 
 #define TEST_First_bound(expected, re, text, ...)                              \
-  TestFirst(&context, __LINE__, re, string(text), expected,__VA_ARGS__, true);
+  TestFirst(&context, __LINE__, re, string(text), expected,__VA_ARGS__, true); \
+  STATIC_TEST(re, TestFirst(&context, __LINE__, re, string(text), expected,    \
+                            __VA_ARGS__, true))
 
 #define TEST_All(re, text, ...)                                                \
-  TestAll(&context, __LINE__, re, string(text), __VA_ARGS__);
+  TestAll(&context, __LINE__, re, string(text), __VA_ARGS__);                  \
+  STATIC_TEST(re, TestAll(&context, __LINE__, re, string(text), __VA_ARGS__))
 
 #define TEST_All_bound(re, text, ...)                                          \
-  TestAll(&context, __LINE__, re, string(text), __VA_ARGS__, true);
+  TestAll(&context, __LINE__, re, string(text), __VA_ARGS__, true);            \
+  STATIC_TEST(re, TestAll(&context, __LINE__, re, string(text), __VA_ARGS__,   \
+                          true))
+
+#define TEST_Shared(re, text, ...)                                             \
+  DoTestShared(&context, __LINE__, re, string(text), __VA_ARGS__);
+
+#define TEST_Cache(expected, re, text)                                         \
+  DoTestCache(&context, __LINE__, re, string(text), expected);
+
+#define TEST_Saved(re, text, ...)                                              \
+  DoTestSaved(&context, __LINE__, re, string(text), __VA_ARGS__);
+
+#define TEST_Corrupted(re, text)                                               \
+  DoTestCorrupted(&context, __LINE__, re, string(text));
+
+#define TEST_Set(res, text, ...)                                               \
+  DoTestSet(&context, __LINE__, res, string(text), __VA_ARGS__);
+
+#define TEST_Stream(re, text, ...)                                             \
+  DoTestStream(&context, __LINE__, re, string(text), __VA_ARGS__);
 
   // Basic tests for the helpers.
   TEST_Full(1, "x", "x");
   TEST_Full(0, "x", "y");
+  TEST_Full(0, "x", "");
   TEST_First(1, "x", "x", {0, 1});
   TEST_First(0, "x", "y", {0, 1});
   TEST_All("x", "x", {{0, 1}});
@@ -293,6 +404,105 @@ int RunTests(const struct arguments *arguments) {
   TEST_All("(ab|b)", "ab", {{0, 2}});
   TEST_All("(b|ab)", "ab", {{0, 2}});
 
+  // Characters matched both by literals and periods.
+  TEST_All("x.z|\ny", "x\nz_\ny_xaz", {{4, 6}, {7, 10}});
+  TEST_All("a.|\rb", "a\r\rbab", {{2, 4}, {4, 6}});
+
+  // Matches starting before the earliest match end.
+  TEST_All("abcabd", "abcabcabd", {{3, 9}});
+  TEST_All(".....x|ab", "aaaaaaaaaab", {{9, 11}});
+  TEST_First(1, "a.........b|xyz", "a__xyz____b", {0, 11});
+  // The most positions the bit-parallel engine handles, and one more.
+  TEST_All(x10("abcdef") "abc.", "_" x10("abcdef") "abcd_", {{1, 65}});
+  TEST_All(x10("abcdef") "abc.e", "_" x10("abcdef") "abcde", {{1, 66}});
+  TEST_First(1, "(a|b).(c|d)|" x10("abcde") "..", "_" x10("abcde") "xyz",
+             {1, 53});
+  TEST_All(x10("abcdef") "|b.|b.....z", "_bcdefgz", {{1, 8}});
+  // Many DFA states.
+  TEST_All("(a|b|c|d)(a|b|c|d)......", x10("abcd") "\n" x10("dcba"),
+           {{0, 8}, {8, 16}, {16, 24}, {24, 32}, {32, 40},
+            {41, 49}, {49, 57}, {57, 65}, {65, 73}, {73, 81}});
+  // Texts with NUL bytes, and literals cut by the end of the text.
+  TEST_All("(a.cdefghijklmnopqrs|x.)", string("a\0cdefghijklmnopqrs\0x\0", 22),
+           {{0, 19}, {20, 22}});
+  TEST_All("(.abcdefghijklmnopq|z)", "_abcdefghijklmnop", {});
+  // Literal prefixes, and regexps matching a single literal.
+  TEST_All("ab(.d|c)", "aabcabxdab", {{1, 4}, {4, 8}});
+  TEST_All("x\ny.", "x\ny\rx\nyz", {{4, 8}});
+  TEST_All("aa", "aaaaa", {{0, 2}, {2, 4}});
+  TEST_Full(0, "abc", "abcabc");
+  // Sets of literals searched for with SIMD, in texts longer than a block.
+  TEST_All("(foo|bar|baz|quux)", "_______________________ba__quu_quux__bar_",
+           {{31, 35}, {37, 40}});
+  TEST_All("a.(foo|bar|baz|quux)",
+           "____________________a_baz_____________a-foo", {{20, 25}, {38, 43}});
+  TEST_All("(f|b|q)", "_______________________________________b", {{39, 40}});
+  // Literals required by all matches.
+  TEST_All("(GET|POST) /api/(v1|v2)/users",
+           "GET /api/v3/users POST /api/v2/users", {{18, 36}});
+  TEST_All("..xyz..", "_xy__xyz___", {{3, 10}});
+  TEST_Full(0, "..xyz..", "__xy_z__");
+  // Literal suffixes, searched for before matching backward.
+  TEST_All(".....-error", "\n-error_12345-error-error", {{8, 19}});
+  TEST_All("(a|b|c)d..timeout", "ad__timeout_bdxtimeout_cd\ntimeout",
+           {{0, 11}});
+  TEST_First(1, "a(.|...)xy", "a_xyxy", {0, 6});
+  TEST_Full(0, ".....-error", "12345-errors");
+  // Optional regexps, matched through epsilon transitions.
+  TEST_All("ab?c", "ac_abc_abbc", {{0, 2}, {3, 6}});
+  TEST_All("abcd?", "abc_abcd", {{0, 3}, {4, 8}});
+  TEST_All("a(bc)?d", "ad_abcd_abd", {{0, 2}, {3, 7}});
+  TEST_All("(a|b)?cd.?", "xcdy_acd\n", {{1, 4}, {5, 8}});
+  TEST_Full(1, "a.?b?", "ab");
+  TEST_Full(0, "ab?c", "abbc");
+  // Only literals, some of them overlapping, and with more positions than the
+  // bit-parallel engine handles.
+  TEST_All("(he|she|his|hers)", "ushers", {{1, 4}});
+  TEST_All("(abc|abcde|cdef)", "abcdef", {{0, 5}});
+  TEST_All("<(foo|bar|baz)>", "<bar><qux><baz>", {{0, 5}, {10, 15}});
+  TEST_All("_(" x10("abcdef") "|abc)_", "_abc__" x10("abcdef") "_",
+           {{0, 5}, {5, 67}});
+
+  // One regexp shared by multiple threads.
+  TEST_Shared("ab..|cd", "__abxx__cd__", {{2, 6}, {8, 10}});
+  TEST_Shared("(abcX|abcd)", x10("abcd"), {{0, 4}, {4, 8}, {8, 12}, {12, 16},
+                                           {16, 20}, {20, 24}, {24, 28},
+                                           {28, 32}, {32, 36}, {36, 40}});
+
+  // Compilation cache.
+  TEST_Cache(1, "abcd|efgh", "efgh");
+  TEST_Cache(0, "a.c", "a\nc");
+
+  // Saved and loaded regexps.
+  TEST_Saved("abcd|efgh", "__efgh__abcd", {{2, 6}, {8, 12}});
+  TEST_Saved("..(abcX|abcd)..", "..abcd..", {{0, 8}});
+  TEST_Saved(x10("abcdefghij"), "_" x10("abcdefghij"), {{1, 101}});
+  // Loading corrupted files fails, or gives regexps that can be matched.
+  TEST_Corrupted("ab(cd|ef.)gh", "__abefxgh__");
+
+  // Sets of regexps. The matches are checked against the regexps matched
+  // individually.
+  TEST_Set(std::vector<const char*>({"abc", "bcd", "xyz"}), "_abcd_", {0, 1});
+  TEST_Set(std::vector<const char*>({"he", "she", "his", "hers"}), "ushers",
+           {0, 1, 3});
+  TEST_Set(std::vector<const char*>({"a.c", "a(b|c)c", "a.?d", "x?y"}),
+           "abc_ad_acc", {0, 1, 2});
+  TEST_Set(std::vector<const char*>({"a.c", "b"}), "a\nc", {});
+  TEST_Set(std::vector<const char*>({"abc|bc", "c", "b?cd"}), "xxabcd",
+           {0, 1, 2});
+  TEST_Set(std::vector<const char*>({}), "abc", {});
+
+  // Streams, fed with chunks of various sizes.
+  TEST_Stream("abcd|efgh", "__efgh__abcd", {{2, 6}, {8, 12}});
+  TEST_Stream("(abcX|abcd)..", "abcXabcdabcd__", {{0, 6}, {8, 14}});
+  TEST_Stream("a.?b?c?", "abcxaxxab", {{0, 3}, {4, 6}, {7, 9}});
+  TEST_Stream("ab..|cd",
+              string(70000, '_') + "abxx" + string(70000, '_') + "cd",
+              {{70000, 70004}, {140004, 140006}});
+  TEST_Stream(x10("abcdefghij"), "_" x10("abcdefghij") x10("abcdefghij"),
+              {{1, 101}, {101, 201}});
+  TEST_Stream("xyz", "xyxyzxy", {{2, 5}});
+
   if (context.test_counters_.count_failed) {
       printf("passed: %d\tfailed: %d\tskipped: %d\t(total: %d)\n",
              context.test_counters_.count_passed,
@@ -308,6 +518,55 @@ int RunTests(const struct arguments *arguments) {
 }
 
 
+// Match with the `Static` regexp of the context if it has one, or else with a
+// `Regit` compiled with the context's options.
+static bool MatchFull(TestContext* context,
+                      const char* regexp, const string& text) {
+  if (context->static_matcher_ != nullptr) {
+    return context->static_matcher_->match_full(text.data(), text.size());
+  }
+  Regit re(regexp);
+  re.Compile(&context->options_);
+  return re.MatchFull(text);
+}
+
+
+static bool MatchAnywhere(TestContext* context, Match* match,
+                          const char* regexp, const string& text) {
+  if (context->static_matcher_ != nullptr) {
+    return context->static_matcher_->match_anywhere(match,
+                                                    text.data(), text.size());
+  }
+  Regit re(regexp);
+  re.Compile(&context->options_);
+  return re.MatchAnywhere(match, text);
+}
+
+
+static bool MatchFirst(TestContext* context, Match* match,
+                       const char* regexp, const string& text) {
+  if (context->static_matcher_ != nullptr) {
+    return context->static_matcher_->match_first(match,
+                                                 text.data(), text.size());
+  }
+  Regit re(regexp);
+  re.Compile(&context->options_);
+  return re.MatchFirst(match, text);
+}
+
+
+static bool MatchAll(TestContext* context, vector<Match>* matches,
+                     const char* regexp, const string& text) {
+  if (context->static_matcher_ != nullptr) {
+    return context->static_matcher_->match_all(matches,
+                                               text.data(), text.size());
+  }
+  Regit re(regexp);
+  re.Compile(&context->options_);
+  return re.MatchAll(matches, text);
+}
+
+
 static bool StartTest(TestContext* context, unsigned line) {
   context->test_id_++;
   if (!ShouldTest(context->arguments_, line, context->test_id_)) {
@@ -329,7 +588,7 @@ static void ReportFailure(TestContext* context, unsigned line,
                           const char* regexp, const string& text,
                           bool expected) {
   printf("FAILED line %d test_id %d\n"
-         "%s\n"
+         "%s%s\n"
          "regexp:\n"
          "%s\n"
          "text:\n"
@@ -337,6 +596,7 @@ static void ReportFailure(TestContext* context, unsigned line,
          "expected: %d",
          line, context->test_id_,
          match_type,
+         (context->static_matcher_ != nullptr) ? " (static)" : "",
          regexp,
          text.c_str(),
          expected);
@@ -363,8 +623,7 @@ static void DoTestFull(TestContext* context, unsigned line,
   bool found = 0;
 
   try {
-    Regit re(regexp);
-    found = re.MatchFull(text);
+    found = MatchFull(context, regexp, text);
   } catch (int e) {
     exception_occurred = true;
   }
@@ -396,8 +655,7 @@ static void DoTestAnywhere(TestContext* context, unsigned line,
   Match match;
 
   try {
-    Regit re(regexp);
-    found = re.MatchAnywhere(&match, text);
+    found = MatchAnywhere(context, &match, regexp, text);
   } catch (int e) {
     exception_occurred = true;
   }
@@ -430,8 +688,7 @@ static void DoTestFirst(TestContext* context, unsigned line,
   Match match;
 
   try {
-    Regit re(regexp);
-    found = re.MatchFirst(&match, text);
+    found = MatchFirst(context, &match, regexp, text);
   } catch (int e) {
     exception_occurred = true;
   }
@@ -479,8 +736,7 @@ static void DoTestAll(TestContext* context, unsigned line,
   vector<Match> matches;
 
   try {
-    Regit re(regexp);
-    re.MatchAll(&matches, text);
+    MatchAll(context, &matches, regexp, text);
   } catch (int e) {
     exception_occurred = true;
   }
@@ -536,6 +792,361 @@ static void DoTestAll(TestContext* context, unsigned line,
 }
 
 
+static void DoTestShared(TestContext* context, unsigned line,
+                         const char* regexp, const string& text,
+                         const std::vector<MatchOffsets>& expected_matches) {
+  if (!StartTest(context, line)) {
+    return;
+  }
+
+  static constexpr int kNThreads = 8;
+  static constexpr int kNIterations = 100;
+  // The regexp is not compiled explicitly. The threads race to compile it.
+  Regit re(regexp);
+  std::atomic<int> n_incorrect(0);
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < kNThreads; i++) {
+    threads.push_back(std::thread([&]() {
+      // Alternate between the default context and an explicit one.
+      MatchContext match_context;
+      if (re.status() != kSuccess) {
+        n_incorrect++;
+      }
+      for (int j = 0; j < kNIterations; j++) {
+        vector<Match> matches;
+        re.MatchAll(&matches, text, (j % 2) ? &match_context : nullptr);
+        bool incorrect_match = (re.status() != kSuccess) ||
+            (matches.size() != expected_matches.size());
+        for (unsigned k = 0; !incorrect_match && k < matches.size(); k++) {
+          incorrect_match =
+              (matches[k].start - text.c_str() != expected_matches[k].start) ||
+              (matches[k].end - text.c_str() != expected_matches[k].end);
+        }
+        if (incorrect_match) {
+          n_incorrect++;
+        }
+      }
+    }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  bool failure = n_incorrect != 0;
+
+  if (failure) {
+    context->test_counters_.count_failed++;
+    ReportFailure(context, line, "match shared", regexp, text, true);
+    printf("\n");
+    printf("incorrect results: %d / %d\n",
+           n_incorrect.load(), kNThreads * kNIterations);
+  } else {
+    context->test_counters_.count_passed++;
+  }
+
+  TestStatus status = failure ? TEST_FAILED : TEST_PASSED;
+  assert(!context->arguments_->break_on_fail || (status == TEST_PASSED));
+}
+
+
+static void DoTestCache(TestContext* context, unsigned line,
+                        const char* regexp, const string& text,
+                        bool expected) {
+  if (!StartTest(context, line)) {
+    return;
+  }
+
+  EnableCompilationCache();
+  CacheCounters counters_before = GetCompilationCacheCounters();
+  Regit re1(regexp);
+  re1.Compile();
+  Regit re2(regexp);
+  re2.Compile();
+  Options posix_options(true);
+  Regit re3(regexp);
+  re3.Compile(&posix_options);
+  // Flags read during compilation are part of the key, like the options.
+  FLAG_parser_opt = !FLAG_parser_opt;
+  Regit re4(regexp);
+  re4.Compile();
+  FLAG_parser_opt = !FLAG_parser_opt;
+  CacheCounters counters_after = GetCompilationCacheCounters();
+  bool found1 = re1.MatchFull(text);
+  bool found2 = re2.MatchFull(text);
+  DisableCompilationCache();
+
+  bool failure =
+      (found1 != expected) || (found2 != expected) ||
+      (re1.rinfo_ != re2.rinfo_) || (re1.rinfo_ == re3.rinfo_) ||
+      (re1.rinfo_ == re4.rinfo_) ||
+      (counters_after.hits - counters_before.hits != 1) ||
+      (counters_after.misses - counters_before.misses != 3) ||
+      (GetCompilationCacheCounters().n_entries != 0);
+
+  if (failure) {
+    context->test_counters_.count_failed++;
+    ReportFailure(context, line, "compilation cache", regexp, text, expected);
+    printf("\n");
+    printf("found: %d %d\n", found1, found2);
+  } else {
+    context->test_counters_.count_passed++;
+  }
+
+  TestStatus status = failure ? TEST_FAILED : TEST_PASSED;
+  assert(!context->arguments_->break_on_fail || (status == TEST_PASSED));
+}
+
+
+static void DoTestSaved(TestContext* context, unsigned line,
+                        const char* regexp, const string& text,
+                        const std::vector<MatchOffsets>& expected_matches) {
+  if (!StartTest(context, line)) {
+    return;
+  }
+
+  char path[] = "/tmp/regit_test_XXXXXX";
+  int fd = mkstemp(path);
+  close(fd);
+  // Save a dummy regexp along with the tested one to check that multiple
+  // regexps can be saved in the same file.
+  Regit dummy("dummy");
+  Regit re(regexp);
+  re.Compile(&context->options_);
+  Status save_status = Regit::Save(path, {&dummy, &re});
+  vector<unique_ptr<Regit>> loaded;
+  Status load_status = Regit::Load(path, &loaded);
+  unlink(path);
+
+  bool incorrect_match = (save_status != kSuccess) ||
+      (load_status != kSuccess) || (loaded.size() != 2);
+  vector<Match> matches;
+  if (!incorrect_match) {
+    loaded[1]->MatchAll(&matches, text);
+    incorrect_match = matches.size() != expected_matches.size();
+  }
+  for (unsigned i = 0; !incorrect_match && i < matches.size(); i++) {
+    incorrect_match =
+        (matches[i].start - text.c_str() != expected_matches[i].start) ||
+        (matches[i].end - text.c_str() != expected_matches[i].end);
+  }
+
+  bool failure = incorrect_match;
+
+  if (failure) {
+    context->test_counters_.count_failed++;
+    ReportFailure(context, line, "saved", regexp, text, true);
+    printf("\n");
+    printf("save status: %d load status: %d matches: %zu\n",
+           save_status, load_status, matches.size());
+  } else {
+    context->test_counters_.count_passed++;
+  }
+
+  TestStatus status = failure ? TEST_FAILED : TEST_PASSED;
+  assert(!context->arguments_->break_on_fail || (status == TEST_PASSED));
+}
+
+
+static void DoTestCorrupted(TestContext* context, unsigned line,
+                            const char* regexp, const string& text) {
+  if (!StartTest(context, line)) {
+    return;
+  }
+
+  char path[] = "/tmp/regit_test_XXXXXX";
+  int fd = mkstemp(path);
+  close(fd);
+  // Save a DFA too, which the loaded programs must cope with when it no longer
+  // agrees with them.
+  Options options = context->options_;
+  options.max_dfa_states_ = std::max(options.max_dfa_states_, 1000u);
+  Regit re(regexp);
+  re.Compile(&options);
+  bool failure = Regit::Save(path, {&re}) != kSuccess;
+  FILE* file = fopen(path, "rb");
+  string data;
+  char buffer[4096];
+  size_t n_read;
+  while ((file != nullptr) &&
+         ((n_read = fread(buffer, 1, sizeof(buffer), file)) != 0)) {
+    data.append(buffer, n_read);
+  }
+  if (file != nullptr) {
+    fclose(file);
+  }
+  // Corrupt each byte in turn. The file may still be valid, as a regexp
+  // matching something else.
+  size_t n_loaded = 0;
+  for (size_t i = 0; !failure && i < data.size(); i++) {
+    string corrupted = data;
+    corrupted[i] ^= 0x5a;
+    file = fopen(path, "wb");
+    failure = (file == nullptr) ||
+        (fwrite(corrupted.data(), 1, corrupted.size(), file) !=
+         corrupted.size());
+    if (file != nullptr) {
+      fclose(file);
+    }
+    vector<unique_ptr<Regit>> loaded;
+    Status status = Regit::Load(path, &loaded);
+    failure |= (status != kSuccess) && (status != kInvalidFormat);
+    for (const unique_ptr<Regit>& loaded_re : loaded) {
+      // Match with the engines selected by the flags, and with all the
+      // optional engines disabled, so that the simulation runs too.
+      Match match;
+      vector<Match> matches;
+      loaded_re->MatchAnywhere(&match, text);
+      loaded_re->MatchAll(&matches, text);
+#define DISABLE_FLAG(flag_name, r, d, desc)                                    \
+      const bool saved_##flag_name = FLAG_##flag_name;                         \
+      FLAG_##flag_name = false;
+#define RESTORE_FLAG(flag_name, r, d, desc)                                    \
+      FLAG_##flag_name = saved_##flag_name;
+      REGIT_FLAGS_LIST(DISABLE_FLAG)
+      loaded_re->MatchAnywhere(&match, text);
+      loaded_re->MatchAll(&matches, text);
+      REGIT_FLAGS_LIST(RESTORE_FLAG)
+#undef DISABLE_FLAG
+#undef RESTORE_FLAG
+      n_loaded++;
+    }
+  }
+  unlink(path);
+
+  if (failure) {
+    context->test_counters_.count_failed++;
+    ReportFailure(context, line, "corrupted", regexp, text, true);
+    printf("\n");
+    printf("file size: %zu loaded: %zu\n", data.size(), n_loaded);
+  } else {
+    context->test_counters_.count_passed++;
+  }
+
+  TestStatus status = failure ? TEST_FAILED : TEST_PASSED;
+  assert(!context->arguments_->break_on_fail || (status == TEST_PASSED));
+}
+
+
+static void DoTestSet(TestContext* context, unsigned line,
+                      const std::vector<const char*>& regexps,
+                      const string& text,
+                      const std::vector<size_t>& expected_ids) {
+  if (!StartTest(context, line)) {
+    return;
+  }
+
+  RegitSet set;
+  string joined_regexps;
+  for (const char* regexp : regexps) {
+    set.Add(regexp);
+    joined_regexps += regexp;
+    joined_regexps += '\n';
+  }
+  set.Compile(&context->options_);
+  vector<bool> matching;
+  vector<Match> matches;
+  bool found = set.MatchAnywhere(&matching, text, &matches);
+
+  // Each regexp must match as it does on its own.
+  bool incorrect_match = (set.status() != kSuccess) ||
+      (found != !expected_ids.empty()) ||
+      (matching.size() != regexps.size()) ||
+      (matches.size() != regexps.size());
+  for (size_t i = 0; !incorrect_match && i < regexps.size(); i++) {
+    bool expected = std::find(expected_ids.begin(), expected_ids.end(), i) !=
+        expected_ids.end();
+    Regit re(regexps[i]);
+    re.Compile(&context->options_);
+    Match match;
+    re.MatchAnywhere(&match, text);
+    incorrect_match = (matching[i] != expected) ||
+        (matches[i].start != (expected ? match.start : kInvalidPos)) ||
+        (matches[i].end != (expected ? match.end : kInvalidPos));
+  }
+
+  bool failure = incorrect_match;
+
+  if (failure) {
+    context->test_counters_.count_failed++;
+    ReportFailure(context, line, "set", joined_regexps.c_str(), text,
+                  !expected_ids.empty());
+    printf("\n");
+    printf("found:");
+    for (size_t i = 0; i < matching.size(); i++) {
+      if (matching[i]) {
+        printf(" %zu ", i);
+        PrintMatch(matches[i].start - text.c_str(),
+                   matches[i].end - text.c_str());
+      }
+    }
+    printf("\n");
+  } else {
+    context->test_counters_.count_passed++;
+  }
+
+  TestStatus status = failure ? TEST_FAILED : TEST_PASSED;
+  assert(!context->arguments_->break_on_fail || (status == TEST_PASSED));
+}
+
+
+static void DoTestStream(TestContext* context, unsigned line,
+                         const char* regexp, const string& text,
+                         const std::vector<MatchOffsets>& expected_matches) {
+  if (!StartTest(context, line)) {
+    return;
+  }
+
+  Regit re(regexp);
+  re.Compile(&context->options_);
+  RegitStream stream(&re);
+  // Feed the text in chunks of each size, including one for the whole text.
+  // The stream is reused from one text to the next.
+  const size_t chunk_sizes[] = {1, 2, 3, 7, 4096, text.size() + 1};
+  bool incorrect_match = stream.status() != kSuccess;
+  size_t incorrect_chunk_size = 0;
+  vector<StreamMatch> matches;
+  for (size_t chunk_size : chunk_sizes) {
+    if (incorrect_match) {
+      break;
+    }
+    matches.clear();
+    for (size_t i = 0; i < text.size(); i += chunk_size) {
+      stream.Feed(&matches, text.c_str() + i,
+                  std::min(chunk_size, text.size() - i));
+    }
+    stream.Finish(&matches);
+    incorrect_match = matches.size() != expected_matches.size();
+    for (unsigned i = 0; !incorrect_match && i < matches.size(); i++) {
+      incorrect_match =
+          (matches[i].start !=
+           static_cast<uint64_t>(expected_matches[i].start)) ||
+          (matches[i].end != static_cast<uint64_t>(expected_matches[i].end));
+    }
+    incorrect_chunk_size = chunk_size;
+  }
+
+  bool failure = incorrect_match;
+
+  if (failure) {
+    context->test_counters_.count_failed++;
+    ReportFailure(context, line, "stream", regexp, text, true);
+    printf("\n");
+    printf("chunk size: %zu found: %zu", incorrect_chunk_size, matches.size());
+    for (const StreamMatch& match : matches) {
+      printf(" ");
+      PrintMatch(match.start, match.end);
+    }
+    printf("\n");
+  } else {
+    context->test_counters_.count_passed++;
+  }
+
+  TestStatus status = failure ? TEST_FAILED : TEST_PASSED;
+  assert(!context->arguments_->break_on_fail || (status == TEST_PASSED));
+}
+
+
 static void TestFull(TestContext* context, unsigned line,
                      const char* regexp, const string& text,
                      bool expected) {
@@ -104,14 +104,50 @@ test_build_options = [
   BuildOption('mode', 'Test with the specified build modes.',
               val_test_choices=['all'] + utils.build_options_modes),
   BuildOption('mc_max_one_char', 'Test with the specified build modes.',
-              val_test_choices=['all'] + ['on', 'off'])
+              val_test_choices=['all'] + ['on', 'off']),
+  BuildOption('std', 'Test with the specified C++ standards.',
+              val_test_choices=['all', 'c++11', 'c++20'])
 ]
 
 test_runtime_options = [
   RunOption('parser_opt',
             '''Test with the specified configurations for parser level
             optimizations.''',
-            val_test_choices=['all', '1', '0'])
+            val_test_choices=['all', '1', '0']),
+  RunOption('use_lazy_dfa',
+            'Test with and without the lazy DFA engine.',
+            val_test_choices=['all', '1', '0']),
+  RunOption('use_bit_parallel',
+            'Test with and without the bit-parallel engine.',
+            val_test_choices=['all', '1', '0']),
+  RunOption('use_aho_corasick',
+            'Test with and without the Aho-Corasick engine.',
+            val_test_choices=['all', '1', '0']),
+  RunOption('use_literal_search',
+            'Test with and without searching for literal prefixes.',
+            val_test_choices=['all', '1', '0']),
+  RunOption('use_prefilter',
+            'Test with and without the required literals prefilter.',
+            val_test_choices=['all', '1', '0']),
+  RunOption('use_teddy',
+            'Test with and without the SIMD search for sets of literals.',
+            val_test_choices=['all', '1', '0']),
+  RunOption('use_reverse_suffix',
+            'Test with and without the reverse suffix search.',
+            val_test_choices=['all', '1', '0']),
+  RunOption('use_reverse_dfa',
+            'Test with and without the reversed lazy DFA.',
+            val_test_choices=['all', '1', '0']),
+  RunOption('use_backtracker',
+            'Test with and without the bounded backtracker.',
+            val_test_choices=['all', '1', '0']),
+  RunOption('max_dfa_states',
+            '''Test with the specified budgets for the DFA built at compilation
+            time. 0 disables it.''',
+            val_test_choices=['all', '0', '8', '10000']),
+  RunOption('jit',
+            'Test with and without compiling the regexps with the JIT.',
+            val_test_choices=['all', '0', '1'])
 ]
 
 test_options = \
@@ -0,0 +1,216 @@
+#include <argp.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_RDTSC
+#endif
+
+#include "regit.h"
+
+using namespace std;
+
+enum MatchType {
+  kMatchFull,
+  kMatchAnywhere,
+  kMatchFirst,
+  kMatchAll
+};
+
+struct arguments {
+  vector<const char*> patterns;
+  const char* text_file;
+  size_t text_size;
+  unsigned repetitions;
+  unsigned max_dfa_states;
+  bool jit;
+  MatchType match_type;
+};
+
+struct argp_option options[] =
+{
+  {"match_type" , 'm' , "first" , 0 ,
+    "Match type. One of `full`, `anywhere`, `first`, or `all`.", 0},
+  {"text" , 't' , "FILE" , 0 ,
+    "Match in the content of FILE instead of generated text.", 0},
+  {"size" , 's' , "BYTES" , 0 ,
+    "The size of the generated text. Defaults to 4MB.", 0},
+  {"repetitions" , 'r' , "N" , 0 ,
+    "Match N times, and report the fastest run. Defaults to 5.", 0},
+  {"max_dfa_states" , 'd' , "N" , 0 ,
+    "Compile with a DFA states budget of N. Defaults to 0, for no DFA.", 0},
+  {"jit" , 'j' , nullptr , 0 ,
+    "Compile the DFA to native code.", 0},
+  {nullptr, 0, nullptr, 0, nullptr, 0}
+};
+
+char args_doc[] = "PATTERN...";
+char doc[] =
+"Measure the matching speed of each PATTERN, in nanoseconds and cycles per "
+"byte of text. The default text is pseudo-random lowercase letters and "
+"newlines, so that patterns containing uppercase letters never match and "
+"measure a full scan of the text.";
+const char *argp_program_bug_address = "<alexandre@uop.re>";
+
+
+error_t parse_opt(int key, char *arg, struct argp_state *state) {
+  struct arguments *arguments = reinterpret_cast<struct arguments*>(state->input);
+  switch (key) {
+    case 'm':
+      if (!strcmp(arg, "full")) {
+        arguments->match_type = kMatchFull;
+      } else if (!strcmp(arg, "anywhere")) {
+        arguments->match_type = kMatchAnywhere;
+      } else if (!strcmp(arg, "first")) {
+        arguments->match_type = kMatchFirst;
+      } else if (!strcmp(arg, "all")) {
+        arguments->match_type = kMatchAll;
+      } else {
+        argp_usage(state);
+      }
+      break;
+    case 't':
+      arguments->text_file = arg;
+      break;
+    case 's':
+      arguments->text_size = strtoul(arg, nullptr, 0);
+      break;
+    case 'r':
+      arguments->repetitions = strtoul(arg, nullptr, 0);
+      if (arguments->repetitions == 0) {
+        argp_usage(state);
+      }
+      break;
+    case 'd':
+      arguments->max_dfa_states = strtoul(arg, nullptr, 0);
+      break;
+    case 'j':
+      arguments->jit = true;
+      break;
+    case ARGP_KEY_ARG:
+      arguments->patterns.push_back(arg);
+      break;
+    case ARGP_KEY_END:
+      if (arguments->patterns.empty()) {
+        argp_usage(state);
+      }
+      break;
+    default:
+      return ARGP_ERR_UNKNOWN;
+  }
+  return 0;
+}
+
+struct argp argp = {options, parse_opt, args_doc, doc, nullptr, nullptr, nullptr};
+
+
+static string GenerateText(size_t size) {
+  string text;
+  text.reserve(size);
+  uint32_t seed = 1;
+  while (text.size() < size) {
+    seed = seed * 1103515245 + 12345;
+    uint32_t r = seed >> 8;
+    text += (r % 64 == 0) ? '\n' : static_cast<char>('a' + r % 26);
+  }
+  return text;
+}
+
+
+static uint64_t ReadCycles() {
+#ifdef HAS_RDTSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+
+static void RunMatch(const regit::Regit* re,
+                     MatchType match_type,
+                     const string& text) {
+  regit::Match match;
+  vector<regit::Match> matches;
+  switch (match_type) {
+    case kMatchFull:
+      re->MatchFull(text.data(), text.size());
+      break;
+    case kMatchAnywhere:
+      re->MatchAnywhere(&match, text.data(), text.size());
+      break;
+    case kMatchFirst:
+      re->MatchFirst(&match, text.data(), text.size());
+      break;
+    case kMatchAll:
+      re->MatchAll(&matches, text.data(), text.size());
+      break;
+  }
+}
+
+
+int main(int argc, char* argv[]) {
+  struct arguments arguments;
+  arguments.text_file = nullptr;
+  arguments.text_size = 4 * 1024 * 1024;
+  arguments.repetitions = 5;
+  arguments.max_dfa_states = 0;
+  arguments.jit = false;
+  arguments.match_type = kMatchFirst;
+  argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+  string text;
+  if (arguments.text_file != nullptr) {
+    ifstream file(arguments.text_file);
+    if (!file) {
+      printf("ERROR: Cannot read %s.\n", arguments.text_file);
+      return EXIT_FAILURE;
+    }
+    stringstream content;
+    content << file.rdbuf();
+    text = content.str();
+  } else {
+    text = GenerateText(arguments.text_size);
+  }
+  if (text.empty()) {
+    printf("ERROR: The text is empty.\n");
+    return EXIT_FAILURE;
+  }
+
+  regit::Options options(false, arguments.max_dfa_states, arguments.jit);
+  for (const char* pattern : arguments.patterns) {
+    regit::Regit re(pattern);
+    re.Compile(&options);
+    if (re.status() != regit::kSuccess) {
+      printf("ERROR: Cannot compile %s.\n", pattern);
+      return EXIT_FAILURE;
+    }
+    double best_ns = 0;
+    uint64_t best_cycles = 0;
+    for (unsigned i = 0; i < arguments.repetitions; i++) {
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      uint64_t start_cycles = ReadCycles();
+      RunMatch(&re, arguments.match_type, text);
+      uint64_t cycles = ReadCycles() - start_cycles;
+      double ns = std::chrono::duration<double, std::nano>(
+          std::chrono::steady_clock::now() - start).count();
+      if ((i == 0) || (ns < best_ns)) {
+        best_ns = ns;
+        best_cycles = cycles;
+      }
+    }
+    printf("%-40s %8.2f ns/byte", pattern, best_ns / text.size());
+#ifdef HAS_RDTSC
+    printf(" %8.2f cycles/byte", static_cast<double>(best_cycles) / text.size());
+#endif
+    printf("\n");
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -29,6 +29,8 @@ struct arguments {
   const char *text;
   regit::MatchType match_type;
   bool print_number_of_matches;
+  unsigned max_dfa_states;
+  bool jit;
   int  regit_flags;
 };
 
@@ -38,6 +40,11 @@ struct argp_option options[] =
     "Match type. One of `full`, `anywhere`, `first`, or `all`.", 1},
   {"n_matches" , 'n' , NULL  , OPTION_ARG_OPTIONAL ,
     "When `text` has been given, print the number of matches.", 1},
+  {"max_dfa_states" , 'd' , "0"  , 0 ,
+    "Build a DFA at compilation time, within this number of states. "
+    "0 disables it.", 1},
+  {"jit" , 'j' , NULL  , OPTION_ARG_OPTIONAL ,
+    "Compile the DFA to native code.", 1},
 #define FLAG_OPTION(flag_name, r, d, desc)                                     \
   {#flag_name , flag_name##_key , FLAG_##flag_name ? "1" : "0",                \
     OPTION_ARG_OPTIONAL , desc "\n0 to disable, 1 to enable.", 2},
@@ -77,6 +84,15 @@ error_t parse_opt(int key, char *arg, struct argp_state *state) {
     }
     case 'n': {
       arguments->print_number_of_matches = true;
+      break;
+    }
+    case 'd': {
+      arguments->max_dfa_states = strtoul(arg, nullptr, 0);
+      break;
+    }
+    case 'j': {
+      arguments->jit = true;
+      break;
     }
     case 'p': {
       unsigned v = (arg != nullptr) ? stol(arg) : 1;
@@ -139,6 +155,8 @@ void handle_arguments(struct arguments *arguments,
   arguments->text = nullptr;
   arguments->match_type = regit::kFull;
   arguments->print_number_of_matches = false;
+  arguments->max_dfa_states = 0;
+  arguments->jit = false;
 
 #define SET_FLAG_DEFAULT(flag_name, r, d, desc)                                \
   arguments->regit_flags |= FLAG_##flag_name << REGIT_FLAG_OFFSET(flag_name);
@@ -167,7 +185,8 @@ int main(int argc, char* argv[]) {
   handle_arguments(&arguments, &argp, argc, argv);
 
   regit::Regit re(arguments.regexp);
-  re.Compile();
+  regit::Options options(false, arguments.max_dfa_states, arguments.jit);
+  re.Compile(&options);
 
   if (arguments.text != nullptr) {
     int n_matches = 0;
@@ -0,0 +1,109 @@
+#include <argp.h>
+#include <fstream>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "regexp_info.h"
+#include "regit.h"
+
+using namespace std;
+
+struct arguments {
+  const char* patterns;
+  const char* output;
+  bool posix_period;
+};
+
+struct argp_option options[] =
+{
+  {"posix_period" , 'p' , nullptr , 0 ,
+    "Compile the regexps with the `posix_period` option.", 0},
+  {nullptr, 0, nullptr, 0, nullptr, 0}
+};
+
+char args_doc[] = "PATTERNS OUTPUT";
+char doc[] =
+"Compile the regexps listed in the PATTERNS file, one per line, and save the "
+"compiled regexps to the OUTPUT file. The file can then be loaded with "
+"`regit::Regit::Load()`. Empty lines are ignored.";
+const char *argp_program_bug_address = "<alexandre@uop.re>";
+
+
+error_t parse_opt(int key, char *arg, struct argp_state *state) {
+  struct arguments *arguments = reinterpret_cast<struct arguments*>(state->input);
+  switch (key) {
+    case 'p':
+      arguments->posix_period = true;
+      break;
+    case ARGP_KEY_ARG:
+      if (state->arg_num == 0) {
+        arguments->patterns = arg;
+      } else if (state->arg_num == 1) {
+        arguments->output = arg;
+      } else {
+        argp_usage(state);
+      }
+      break;
+    case ARGP_KEY_END:
+      if (state->arg_num != 2) {
+        argp_usage(state);
+      }
+      break;
+    default:
+      return ARGP_ERR_UNKNOWN;
+  }
+  return 0;
+}
+
+struct argp argp = {options, parse_opt, args_doc, doc, nullptr, nullptr, nullptr};
+
+
+int main(int argc, char* argv[]) {
+  struct arguments arguments;
+  arguments.patterns = nullptr;
+  arguments.output = nullptr;
+  arguments.posix_period = false;
+  argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+  ifstream patterns(arguments.patterns);
+  if (!patterns) {
+    printf("ERROR: Cannot read %s.\n", arguments.patterns);
+    return EXIT_FAILURE;
+  }
+
+  regit::Options options(arguments.posix_period);
+  vector<unique_ptr<regit::Regit>> regexps;
+  vector<const regit::Regit*> to_save;
+  string line;
+  unsigned line_number = 0;
+  uint64_t compilation_time = 0;
+  size_t compiled_size = 0;
+  while (getline(patterns, line)) {
+    line_number++;
+    if (line.empty()) {
+      continue;
+    }
+    regexps.push_back(unique_ptr<regit::Regit>(new regit::Regit(line)));
+    regexps.back()->Compile(&options);
+    if (regexps.back()->status() != regit::kSuccess) {
+      printf("ERROR: Cannot compile the regexp on line %u.\n", line_number);
+      return EXIT_FAILURE;
+    }
+    to_save.push_back(regexps.back().get());
+    compilation_time += regexps.back()->rinfo_->compilation_time();
+    compiled_size += regexps.back()->rinfo_->size();
+  }
+
+  if (regit::Regit::Save(arguments.output, to_save) != regit::kSuccess) {
+    printf("ERROR: Cannot write %s.\n", arguments.output);
+    return EXIT_FAILURE;
+  }
+  printf("Compiled %zu regexp(s) in %.3f ms, using %zu bytes.\n",
+         to_save.size(), compilation_time / 1e6, compiled_size);
+  printf("Saved %zu regexp(s) to %s.\n", to_save.size(), arguments.output);
+
+  return EXIT_SUCCESS;
+}